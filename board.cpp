@@ -1,11 +1,16 @@
 #include <algorithm>
 #include <cmath>
 #include <cctype>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 #include "include/board.h"
+#include "include/movepick.h"
+#include "include/profile.h"
 #include "include/pst_tables.h"
+#include "include/trace.h"
+#include "include/tt.h"
 
 int square_to_index(const std::string& square) {
     if (square.size() != 2) {
@@ -49,6 +54,8 @@ void init_board(Board& b) {
     b.board[5] = W_BISHOP; b.board[61] = B_BISHOP;
     b.board[6] = W_KNIGHT; b.board[62] = B_KNIGHT;
     b.board[7] = W_ROOK;   b.board[63] = B_ROOK;
+
+    refresh_attacks(b);
 }
 
 char get_piece_char(Piece p) {
@@ -78,15 +85,12 @@ Piece get_piece_from_char(char c) {
 }
 
 int get_piece_value(Piece p) {
-    static const int piece_values[] = {
-        100, 500, 320, 330, 900, 20000,
-        100, 500, 320, 330, 900, 20000,
-        0
-    };
     return piece_values[p];
 }
 
 int evaluate(const Board& b) {
+    PROFILE_SCOPE(PROBE_EVALUATE);
+
     int total = 0;
 
     for (int i = 0; i < 64; i++) {
@@ -103,6 +107,21 @@ int evaluate(const Board& b) {
     return total;
 }
 
+uint64_t evaluation_fingerprint() {
+    // FNV-1a over every parameter evaluate and see read
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto mix = [&hash](const int* values, int count) {
+        for (int i = 0; i < count; i++) {
+            hash ^= static_cast<uint32_t>(values[i]);
+            hash *= 0x100000001B3ULL;
+        }
+    };
+    mix(piece_values, 13);
+    mix(pawn_table, 64);
+    mix(knight_table, 64);
+    return hash;
+}
+
 void print_board(const Board& b) {
     // index = (rank * 8) + file
     for (int rank = 7; rank >= 0; rank--) {
@@ -119,7 +138,337 @@ bool is_white_turn(const Board& b) {
     return b.side_to_move == WHITE;
 }
 
-UndoInfo make_move(Board& b, Move move) {
+// compile-time facts about one side. the hot board routines below are
+// written once against these and instantiated for white and black.
+template <Color Us>
+struct Side {
+    static constexpr Color them = (Us == WHITE) ? BLACK : WHITE;
+
+    // own pieces are first .. first + 5, in the order of the Piece enum
+    static constexpr int first = (Us == WHITE) ? W_PAWN : B_PAWN;
+    static constexpr Piece pawn = static_cast<Piece>(first + W_PAWN);
+    static constexpr Piece rook = static_cast<Piece>(first + W_ROOK);
+    static constexpr Piece knight = static_cast<Piece>(first + W_KNIGHT);
+    static constexpr Piece bishop = static_cast<Piece>(first + W_BISHOP);
+    static constexpr Piece queen = static_cast<Piece>(first + W_QUEEN);
+    static constexpr Piece king = static_cast<Piece>(first + W_KING);
+
+    static constexpr int up = (Us == WHITE) ? 8 : -8;
+    static constexpr int start_rank = (Us == WHITE) ? 1 : 6;
+    static constexpr int promotion_rank = (Us == WHITE) ? 7 : 0;
+
+    static constexpr int home = (Us == WHITE) ? 0 : 56; // a1 / a8, the king starts on home + 4
+    static constexpr int castle_king = (Us == WHITE) ? CASTLE_WK : CASTLE_BK;
+    static constexpr int castle_queen = (Us == WHITE) ? CASTLE_WQ : CASTLE_BQ;
+
+    static bool own(Piece p) { return static_cast<unsigned>(static_cast<int>(p) - first) < 6u; }
+};
+
+static constexpr int kKnightOffsets[] = {-17, -15, -10, -6, 6, 10, 15, 17};
+static constexpr int kKingOffsets[] = {-9, -8, -7, -1, 1, 7, 8, 9};
+static constexpr int kBishopOffsets[] = {-9, -7, 7, 9};
+static constexpr int kRookOffsets[] = {-8, 8, -1, 1};
+static constexpr int kQueenOffsets[] = {-9, -7, 7, 9, -8, 8, -1, 1};
+
+// attack maps (CHESS_ATTACK_MAPS). Board::attackers counts, per side, the
+// pieces attacking each square. a change on one square only moves the
+// attacks of the piece there and of sliders whose line runs through it, so
+// make/unmake touch just those instead of rebuilding everything. without
+// the maps set_square/clear_square are plain writes.
+
+#ifdef CHESS_ATTACK_MAPS
+
+namespace {
+
+// N S E W NE SW NW SE: opposite directions differ in the lowest bit,
+// the first four are rook lines and the last four bishop lines
+constexpr int kDirFile[8] = {0, 0, 1, -1, 1, -1, -1, 1};
+constexpr int kDirRank[8] = {1, -1, 0, 0, 1, -1, 1, -1};
+
+struct AttackTables {
+    int8_t ray[64][8][7];
+    uint8_t ray_len[64][8];
+    int8_t knight[64][8];
+    uint8_t knight_len[64];
+    int8_t king[64][8];
+    uint8_t king_len[64];
+    int8_t pawn[2][64][2];
+    uint8_t pawn_len[2][64];
+};
+
+AttackTables build_attack_tables() {
+    AttackTables t{};
+
+    auto on_board = [](int file, int rank) { return file >= 0 && file < 8 && rank >= 0 && rank < 8; };
+
+    for (int sq = 0; sq < 64; sq++) {
+        const int file = sq % 8;
+        const int rank = sq / 8;
+
+        for (int d = 0; d < 8; d++) {
+            for (int f = file + kDirFile[d], r = rank + kDirRank[d]; on_board(f, r); f += kDirFile[d], r += kDirRank[d]) {
+                t.ray[sq][d][t.ray_len[sq][d]++] = static_cast<int8_t>(r * 8 + f);
+            }
+        }
+
+        static const int knight_steps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+        for (const auto& step : knight_steps) {
+            if (on_board(file + step[0], rank + step[1])) {
+                t.knight[sq][t.knight_len[sq]++] = static_cast<int8_t>((rank + step[1]) * 8 + file + step[0]);
+            }
+        }
+
+        for (int d = 0; d < 8; d++) {
+            if (on_board(file + kDirFile[d], rank + kDirRank[d])) {
+                t.king[sq][t.king_len[sq]++] = static_cast<int8_t>((rank + kDirRank[d]) * 8 + file + kDirFile[d]);
+            }
+        }
+
+        for (int side = 0; side < 2; side++) {
+            const int forward = (side == WHITE) ? 1 : -1;
+            for (int df : {-1, 1}) {
+                if (on_board(file + df, rank + forward)) {
+                    t.pawn[side][sq][t.pawn_len[side][sq]++] = static_cast<int8_t>((rank + forward) * 8 + file + df);
+                }
+            }
+        }
+    }
+
+    return t;
+}
+
+const AttackTables kAttackTables = build_attack_tables();
+
+inline int piece_color(Piece p) { return p / 6; }
+inline int piece_kind(Piece p) { return p % 6; } // W_PAWN .. W_KING
+
+inline bool slides_on(Piece p, int dir) {
+    const int kind = piece_kind(p);
+    return kind == W_QUEEN || (kind == W_ROOK && dir < 4) || (kind == W_BISHOP && dir >= 4);
+}
+
+inline void count_attack(Board& b, int side, int sq, int delta) {
+    uint8_t& n = b.attackers[side][sq];
+    n = static_cast<uint8_t>(n + delta);
+    const uint64_t bit = uint64_t{1} << sq;
+    b.attacked[side] = (b.attacked[side] & ~bit) | (n ? bit : 0);
+}
+
+// squares a slider on sq reaches along dir, up to and including the first piece
+inline void count_ray(Board& b, int side, int sq, int dir, int delta) {
+    const int8_t* ray = kAttackTables.ray[sq][dir];
+    for (int i = 0; i < kAttackTables.ray_len[sq][dir]; i++) {
+        count_attack(b, side, ray[i], delta);
+        if (b.board[ray[i]] != EMPTY) break;
+    }
+}
+
+// adds (delta 1) or removes (delta -1) the attacks of piece p standing on sq
+void count_piece(Board& b, int sq, Piece p, int delta) {
+    const int side = piece_color(p);
+    const AttackTables& t = kAttackTables;
+
+    switch (piece_kind(p)) {
+    case W_PAWN:
+        for (int i = 0; i < t.pawn_len[side][sq]; i++) count_attack(b, side, t.pawn[side][sq][i], delta);
+        break;
+    case W_KNIGHT:
+        for (int i = 0; i < t.knight_len[sq]; i++) count_attack(b, side, t.knight[sq][i], delta);
+        break;
+    case W_KING:
+        for (int i = 0; i < t.king_len[sq]; i++) count_attack(b, side, t.king[sq][i], delta);
+        break;
+    case W_ROOK:
+        for (int d = 0; d < 4; d++) count_ray(b, side, sq, d, delta);
+        break;
+    case W_BISHOP:
+        for (int d = 4; d < 8; d++) count_ray(b, side, sq, d, delta);
+        break;
+    case W_QUEEN:
+        for (int d = 0; d < 8; d++) count_ray(b, side, sq, d, delta);
+        break;
+    }
+}
+
+// sq is empty. every slider looking at sq gets the squares behind it added
+// (sq just emptied, delta 1) or taken away (sq about to fill, delta -1).
+void count_lines_through(Board& b, int sq, int delta) {
+    for (int d = 0; d < 8; d++) {
+        // the first piece looking back the other way
+        const int back = d ^ 1;
+        const int8_t* ray = kAttackTables.ray[sq][back];
+        for (int i = 0; i < kAttackTables.ray_len[sq][back]; i++) {
+            const Piece p = b.board[ray[i]];
+            if (p == EMPTY) continue;
+
+            if (slides_on(p, d)) count_ray(b, piece_color(p), sq, d, delta);
+            break;
+        }
+    }
+}
+
+void clear_square(Board& b, int sq) {
+    const Piece old = b.board[sq];
+    if (old == EMPTY) return;
+
+    count_piece(b, sq, old, -1);
+    b.board[sq] = EMPTY;
+    count_lines_through(b, sq, 1);
+}
+
+void set_square(Board& b, int sq, Piece p) {
+    if (p == EMPTY) {
+        clear_square(b, sq);
+        return;
+    }
+
+    const Piece old = b.board[sq];
+    if (old == EMPTY) count_lines_through(b, sq, -1);
+    else count_piece(b, sq, old, -1);
+
+    b.board[sq] = p;
+    count_piece(b, sq, p, 1);
+}
+
+} // namespace
+
+void refresh_attacks(Board& b) {
+    for (auto& side : b.attackers) side.fill(0);
+    b.attacked = {0, 0};
+
+    for (int sq = 0; sq < 64; sq++) {
+        if (b.board[sq] != EMPTY) count_piece(b, sq, b.board[sq], 1);
+    }
+}
+
+#else
+
+static inline void clear_square(Board& b, int sq) { b.board[sq] = EMPTY; }
+static inline void set_square(Board& b, int sq, Piece p) { b.board[sq] = p; }
+
+void refresh_attacks(Board&) {}
+
+#endif
+
+// square of the cheapest piece of Attacker that attacks square, or -1.
+// works on a bare piece array so see() can lift pieces off and look again,
+// which is how sliders hiding behind the first attacker (x-rays) show up.
+template <Color Attacker>
+static int least_valuable_attacker(const std::array<Piece, 64>& board, int square) {
+    using S = Side<Attacker>;
+
+    const int file = square % 8;
+
+    // pawns attack one rank up from their point of view, so look one rank back
+    const int west = square - S::up - 1;
+    const int east = square - S::up + 1;
+    if (file != 0 && west >= 0 && west < 64 && board[west] == S::pawn) return west;
+    if (file != 7 && east >= 0 && east < 64 && board[east] == S::pawn) return east;
+
+    for (int offset : kKnightOffsets) {
+        int target = square + offset;
+
+        if (target < 0 || target >= 64) continue;
+        if (std::abs(file - target % 8) > 2) continue; // wrap around check
+
+        if (board[target] == S::knight) return target;
+    }
+
+    // sliding pieces. a queen found on the way is kept until we know
+    // there's no cheaper bishop or rook.
+
+    int queen_sq = -1;
+
+    for (int offset : kBishopOffsets) {
+        int target = square;
+
+        while (true) {
+            target += offset;
+
+            if (target < 0 || target >= 64) break;
+
+            int target_file = target % 8;
+
+            if ((offset == -9 || offset == 7) && target_file == 7) break;
+            if ((offset == -7 || offset == 9) && target_file == 0) break;
+
+            if (board[target] == EMPTY) continue;
+
+            if (board[target] == S::bishop) return target;
+            if (board[target] == S::queen) queen_sq = target;
+
+            break; // hit a piece, stop sliding
+        }
+    }
+
+    for (int offset : kRookOffsets) {
+        int target = square;
+
+        while (true) {
+            target += offset;
+
+            if (target < 0 || target >= 64) break;
+
+            int target_file = target % 8;
+
+            // wrap check for horizontal movement
+
+            if (offset == -1 && target_file == 7) break; // wrap left
+            if (offset == 1 && target_file == 0) break; // wrap right
+
+            if (board[target] == EMPTY) continue;
+
+            if (board[target] == S::rook) return target;
+            if (board[target] == S::queen) queen_sq = target;
+
+            break;
+        }
+    }
+
+    if (queen_sq >= 0) return queen_sq;
+
+    for (int offset : kKingOffsets) {
+        int target = square + offset;
+
+        if (target < 0 || target >= 64) continue;
+        if (std::abs(file - target % 8) > 1) continue;
+
+        if (board[target] == S::king) return target;
+    }
+
+    return -1;
+}
+
+static int least_valuable_attacker(const std::array<Piece, 64>& board, int square, Color side_attacking) {
+    return (side_attacking == WHITE) ? least_valuable_attacker<WHITE>(board, square)
+                                     : least_valuable_attacker<BLACK>(board, square);
+}
+
+template <Color Attacker>
+static bool attacked(const Board& b, int square) {
+    PROFILE_SCOPE(PROBE_IS_SQUARE_ATTACKED);
+
+#ifdef CHESS_ATTACK_MAPS
+    return square >= 0 && b.attackers[Attacker][square] != 0;
+#else
+    return least_valuable_attacker<Attacker>(b.board, square) >= 0;
+#endif
+}
+
+bool is_square_attacked(const Board& b, int square, Color side_attacking) {
+    return (side_attacking == WHITE) ? attacked<WHITE>(b, square) : attacked<BLACK>(b, square);
+}
+
+bool scan_square_attacked(const Board& b, int square, Color side_attacking) {
+    return least_valuable_attacker(b.board, square, side_attacking) >= 0;
+}
+
+// Us is the colour of the moving piece
+template <Color Us>
+static UndoInfo make_move(Board& b, Move move) {
+    PROFILE_SCOPE(PROBE_MAKE_MOVE);
+
+    using S = Side<Us>;
 
     UndoInfo undo;
     undo.prev_castling_rights = b.castling_rights;
@@ -129,86 +478,52 @@ UndoInfo make_move(Board& b, Move move) {
     undo.captured_piece = b.board[move.to];
 
     // if a rook is captured, update castling rights
-    if (move.to == square_to_index("h1")) b.castling_rights &= ~CASTLE_WK;
-    if (move.to == square_to_index("a1")) b.castling_rights &= ~CASTLE_WQ;
-    if (move.to == square_to_index("h8")) b.castling_rights &= ~CASTLE_BK;
-    if (move.to == square_to_index("a8")) b.castling_rights &= ~CASTLE_BQ;
-
-    Piece p = b.board[move.from];    
+    if (move.to == 7) b.castling_rights &= ~CASTLE_WK;  // h1
+    if (move.to == 0) b.castling_rights &= ~CASTLE_WQ;  // a1
+    if (move.to == 63) b.castling_rights &= ~CASTLE_BK; // h8
+    if (move.to == 56) b.castling_rights &= ~CASTLE_BQ; // a8
 
-    b.board[move.from] = EMPTY;
-    b.board[move.to] = p;
+    const Piece p = b.board[move.from];
+    Piece landed = p;
 
-    
+    clear_square(b, move.from);
 
-    if (p == W_KING) { // lose castling rights on both sides
+    if (p == S::king) { // lose castling rights on both sides
         int distance = move.to - move.from;
 
         if (distance == 2) { // kingside castle
-            if (b.board[square_to_index("h1")] == W_ROOK) {
-                b.board[square_to_index("h1")] = EMPTY;
-                b.board[square_to_index("f1")] = W_ROOK;
+            if (b.board[S::home + 7] == S::rook) {
+                clear_square(b, S::home + 7);
+                set_square(b, S::home + 5, S::rook);
             }
         } else if (distance == -2) { // queenside castle
-            if (b.board[square_to_index("a1")] == W_ROOK) {
-                b.board[square_to_index("a1")] = EMPTY;
-                b.board[square_to_index("d1")] = W_ROOK;
+            if (b.board[S::home] == S::rook) {
+                clear_square(b, S::home);
+                set_square(b, S::home + 3, S::rook);
             }
         }
 
-        b.castling_rights &= ~CASTLE_WK;
-        b.castling_rights &= ~CASTLE_WQ;
+        b.castling_rights &= ~(S::castle_king | S::castle_queen);
     }
 
-    if (p == W_ROOK) {
-        if (move.from == square_to_index("h1")) b.castling_rights &= ~CASTLE_WK;
-        if (move.from == square_to_index("a1")) b.castling_rights &= ~CASTLE_WQ;
-    }
-
-    if (p == B_KING) {
-        int distance = move.to - move.from;
-
-        if (distance == 2) {
-            if (b.board[square_to_index("h8")] == B_ROOK) {
-                b.board[square_to_index("h8")] = EMPTY;
-                b.board[square_to_index("f8")] = B_ROOK;
-            }
-        } else if (distance == -2) {
-            if (b.board[square_to_index("a8")] == B_ROOK) {
-                b.board[square_to_index("a8")] = EMPTY;
-                b.board[square_to_index("d8")] = B_ROOK;
-            }
-        }
-        b.castling_rights &= ~CASTLE_BK;
-        b.castling_rights &= ~CASTLE_BQ;
-    }
-
-    if (p == B_ROOK) {
-        if (move.from == square_to_index("h8")) b.castling_rights &= ~CASTLE_BK;
-        if (move.from == square_to_index("a8")) b.castling_rights &= ~CASTLE_BQ;
+    if (p == S::rook) {
+        if (move.from == S::home + 7) b.castling_rights &= ~S::castle_king;
+        if (move.from == S::home) b.castling_rights &= ~S::castle_queen;
     }
 
     int new_en_passant = -1;
 
-    if (p == W_PAWN) {
-        if (move.to / 8 == 7) b.board[move.to] = W_QUEEN;
+    if (p == S::pawn) {
+        if (move.to / 8 == S::promotion_rank) landed = S::queen;
         if (move.to == b.en_passant_square) {
-            undo.captured_square = move.to - 8;
-            undo.captured_piece = b.board[move.to - 8];
-            b.board[move.to - 8] = EMPTY;
+            undo.captured_square = move.to - S::up;
+            undo.captured_piece = b.board[move.to - S::up];
+            clear_square(b, move.to - S::up);
         }
-        if (move.to - move.from == 16) new_en_passant = move.from + 8;
+        if (move.to - move.from == 2 * S::up) new_en_passant = move.from + S::up;
     }
 
-    if (p == B_PAWN) {
-        if (move.to / 8 == 0) b.board[move.to] = B_QUEEN;
-        if (move.to == b.en_passant_square) {
-            undo.captured_square = move.to + 8;
-            undo.captured_piece = b.board[move.to + 8];
-            b.board[move.to + 8] = EMPTY;
-        }
-        if (move.from - move.to == 16) new_en_passant = move.from - 8;
-    }
+    set_square(b, move.to, landed);
 
     b.en_passant_square = new_en_passant;
     b.side_to_move = (b.side_to_move == WHITE) ? BLACK : WHITE;
@@ -216,7 +531,15 @@ UndoInfo make_move(Board& b, Move move) {
     return undo;
 }
 
-void unmake_move(Board& b, Move move, const UndoInfo& state){
+UndoInfo make_move(Board& b, Move move) {
+    return (b.board[move.from] <= W_KING) ? make_move<WHITE>(b, move) : make_move<BLACK>(b, move);
+}
+
+template <Color Us>
+static void unmake_move(Board& b, Move move, const UndoInfo& state) {
+    PROFILE_SCOPE(PROBE_UNMAKE_MOVE);
+
+    using S = Side<Us>;
 
     // restore turn and state
 
@@ -224,40 +547,32 @@ void unmake_move(Board& b, Move move, const UndoInfo& state){
     b.castling_rights = state.prev_castling_rights;
     b.en_passant_square = state.prev_en_passant_square;
 
-    // move piece back
-    b.board[move.from] = state.moved_piece;
-
-    // clear destination square
-    b.board[move.to] = EMPTY;
+    // clear destination square and move piece back
+    clear_square(b, move.to);
+    set_square(b, move.from, state.moved_piece);
 
     // undo castling
-    if (state.moved_piece == W_KING) {
+    if (state.moved_piece == S::king) {
         int distance = move.to - move.from;
-        if (distance == 2) { // white kingside
-            b.board[square_to_index("h1")] = W_ROOK;
-            b.board[square_to_index("f1")] = EMPTY;
+        if (distance == 2) { // kingside
+            clear_square(b, S::home + 5);
+            set_square(b, S::home + 7, S::rook);
         }
-        else if (distance == -2) { // white queenside
-            b.board[square_to_index("a1")] = W_ROOK;
-            b.board[square_to_index("d1")] = EMPTY;
-        }
-    } else if (state.moved_piece == B_KING) {
-        int distance = move.to - move.from;
-        if (distance == 2) { // black kingside
-            b.board[square_to_index("h8")] = B_ROOK;
-            b.board[square_to_index("f8")] = EMPTY;
-        }
-        else if (distance == -2) { // black queenside
-            b.board[square_to_index("a8")] = B_ROOK;
-            b.board[square_to_index("d8")] = EMPTY;
+        else if (distance == -2) { // queenside
+            clear_square(b, S::home + 3);
+            set_square(b, S::home, S::rook);
         }
     }
 
     // restore captured piece
     if (state.captured_piece != EMPTY) {
-        b.board[state.captured_square] = state.captured_piece;
+        set_square(b, state.captured_square, state.captured_piece);
     }
+}
 
+void unmake_move(Board& b, Move move, const UndoInfo& state) {
+    if (state.moved_piece <= W_KING) unmake_move<WHITE>(b, move, state);
+    else unmake_move<BLACK>(b, move, state);
 }
 
 int find_king(const Board& b, Color side) {
@@ -269,409 +584,699 @@ int find_king(const Board& b, Color side) {
     return -1; // lol should never happen
 }
 
-std::vector<Move> generate_pseudo_moves(const Board& b) {
-    std::vector<Move> moves;
+// which moves a generator emits. captures are moves onto an enemy piece or
+// the en passant square; everything else, castling and promotion pushes
+// included, is quiet.
+enum GenType { GEN_ALL, GEN_CAPTURES, GEN_QUIETS };
 
-    for (int i = 0; i < 64; i++) {
-        std::vector<int> offsets;
-
-        if ((b.board[i] == W_ROOK && b.side_to_move == WHITE) || (b.board[i] == B_ROOK && b.side_to_move == BLACK)) {
-            offsets = {-8, 8, -1, 1};
-        }
-        if ((b.board[i] == W_BISHOP && b.side_to_move == WHITE) || (b.board[i] == B_BISHOP && b.side_to_move == BLACK)) {
-            offsets = {-9, -7, 7, 9};
-        }
-        if ((b.board[i] == W_QUEEN && b.side_to_move == WHITE) || (b.board[i] == B_QUEEN && b.side_to_move == BLACK)) {
-            offsets = {-9, -7, 7, 9, -8, 8, -1, 1};
-        }
+template <Color Us, GenType Gen, size_t N>
+static void generate_slides(const Board& b, int i, const int (&offsets)[N], std::vector<Move>& moves) {
+    for (int offset : offsets) {
+        int target = i;
 
-        int file = i % 8;
-        int rank = i / 8;
+        while (true) {
+            target += offset;
 
-        // pawns
+            if (target < 0 || target >= 64) break;
 
-        if (b.board[i] == W_PAWN && b.side_to_move == WHITE) {
-            if (i + 8 < 64 && b.board[i + 8] == EMPTY) {
-                moves.push_back({i, i + 8}); // single push
+            int target_file = target % 8;
+            if ((offset == -1 || offset == -9 || offset == 7) && target_file == 7) break; //wrap left
+            if ((offset == 1 || offset == 9 || offset == -7 ) && target_file == 0) break; // wrap right
 
-                if (rank == 1 && b.board[i + 16] == EMPTY) { // double push
-                    moves.push_back({i, i + 16});
-                }
+            if (b.board[target] == EMPTY) {
+                if (Gen != GEN_CAPTURES) moves.push_back({i, target});
+                continue;
             }
 
-            // captures
-            if (file != 0 && i + 7 < 64 && ((B_PAWN <= b.board[i + 7] && b.board[i + 7] <= B_KING) || (i + 7 == b.en_passant_square))) {
-                moves.push_back({i, i + 7});
-            }
-            if (file != 7 && i + 9 < 64 && ((B_PAWN <= b.board[i + 9] && b.board[i + 9] <= B_KING) || (i + 9 == b.en_passant_square))) {
-                moves.push_back({i, i + 9});
-            }
+            if (Gen != GEN_QUIETS && !Side<Us>::own(b.board[target])) moves.push_back({i, target});
+
+            break; // hit a piece
         }
+    }
+}
 
-        if (b.board[i] == B_PAWN && b.side_to_move == BLACK) {
-            if (i - 8 >= 0 && b.board[i - 8] == EMPTY) {
-                moves.push_back({i, i - 8});
+template <Color Us, GenType Gen, size_t N>
+static void generate_steps(const Board& b, int i, const int (&offsets)[N], int max_file_distance,
+                           std::vector<Move>& moves) {
+    const int start_file = i % 8;
 
-                if (rank == 6 && b.board[i - 16] == EMPTY) {
-                    moves.push_back({i, i - 16});
-                }
-            }
+    for (int offset : offsets) {
+        int target = i + offset;
 
-            if (file != 0 && i - 9 >= 0 && ((W_PAWN <= b.board[i - 9] && b.board[i - 9] <= W_KING) || (i - 9 == b.en_passant_square))) {
-                moves.push_back({i, i - 9});
-            }
-            if (file != 7 && i - 7 >= 0 && ((W_PAWN <= b.board[i - 7] && b.board[i - 7] <= W_KING) || (i - 7 == b.en_passant_square))) {
-                moves.push_back({i, i - 7});
+        if (target < 0 || target >= 64) continue;
+        if (std::abs(start_file - target % 8) > max_file_distance) continue;
+        if (Side<Us>::own(b.board[target])) continue;
+        if (Gen == GEN_CAPTURES && b.board[target] == EMPTY) continue;
+        if (Gen == GEN_QUIETS && b.board[target] != EMPTY) continue;
+
+        moves.push_back({i, target});
+    }
+}
+
+template <Color Us, GenType Gen = GEN_ALL>
+static void generate_square_moves(const Board& b, int i, std::vector<Move>& moves) {
+    using S = Side<Us>;
+
+    const Piece p = b.board[i];
+    if (!S::own(p)) return;
+
+    switch (static_cast<int>(p) - S::first) {
+    case W_PAWN: {
+        const int file = i % 8;
+        const int ahead = i + S::up;
+
+        if (Gen != GEN_CAPTURES && ahead >= 0 && ahead < 64 && b.board[ahead] == EMPTY) {
+            moves.push_back({i, ahead}); // single push
+
+            if (i / 8 == S::start_rank && b.board[ahead + S::up] == EMPTY) { // double push
+                moves.push_back({i, ahead + S::up});
             }
         }
 
-        // knights
+        if (Gen == GEN_QUIETS) break;
 
-        if ((b.board[i] == W_KNIGHT && b.side_to_move == WHITE) || (b.board[i] == B_KNIGHT && b.side_to_move == BLACK)) {
-            std::vector<int> knight_offsets = {-17, -15, -10, -6, 6, 10, 15, 17};
+        // captures
+        const int west = ahead - 1;
+        const int east = ahead + 1;
+        if (file != 0 && west >= 0 && west < 64 &&
+            (Side<S::them>::own(b.board[west]) || west == b.en_passant_square)) {
+            moves.push_back({i, west});
+        }
+        if (file != 7 && east >= 0 && east < 64 &&
+            (Side<S::them>::own(b.board[east]) || east == b.en_passant_square)) {
+            moves.push_back({i, east});
+        }
+        break;
+    }
 
-            int start_file = i % 8;
+    case W_KNIGHT:
+        generate_steps<Us, Gen>(b, i, kKnightOffsets, 2, moves);
+        break;
 
-            for (int offset : knight_offsets) {
-                int target = i + offset;
-                int target_file = target % 8;
+    case W_KING: {
+        generate_steps<Us, Gen>(b, i, kKingOffsets, 1, moves);
 
-                if (target < 0 || target >= 64) continue;
-                if (std::abs(start_file - target_file) > 2) continue;
-                if (b.side_to_move == WHITE && W_PAWN <= b.board[target] && b.board[target] <= W_KING) continue;
-                if (b.side_to_move == BLACK && B_PAWN <= b.board[target] && b.board[target] <= B_KING) continue;
+        if (Gen == GEN_CAPTURES) break;
 
-                moves.push_back({i, target});
-            }
+        const int e = S::home + 4;
+
+        if ((b.castling_rights & S::castle_king)
+         && b.board[S::home + 7] == S::rook
+         && b.board[S::home + 5] == EMPTY
+         && b.board[S::home + 6] == EMPTY
+         && !attacked<S::them>(b, e)
+         && !attacked<S::them>(b, S::home + 5)
+         && !attacked<S::them>(b, S::home + 6)) {
+            moves.push_back({e, S::home + 6});
+        }
+
+        if ((b.castling_rights & S::castle_queen)
+         && b.board[S::home] == S::rook
+         && b.board[S::home + 1] == EMPTY
+         && b.board[S::home + 2] == EMPTY
+         && b.board[S::home + 3] == EMPTY
+         && !attacked<S::them>(b, e)
+         && !attacked<S::them>(b, S::home + 3)
+         && !attacked<S::them>(b, S::home + 2)) {
+            moves.push_back({e, S::home + 2});
         }
+        break;
+    }
 
-        // kings
+    case W_ROOK:
+        generate_slides<Us, Gen>(b, i, kRookOffsets, moves);
+        break;
+    case W_BISHOP:
+        generate_slides<Us, Gen>(b, i, kBishopOffsets, moves);
+        break;
+    case W_QUEEN:
+        generate_slides<Us, Gen>(b, i, kQueenOffsets, moves);
+        break;
+    }
+}
 
-        if ((b.board[i] == W_KING && b.side_to_move == WHITE) || (b.board[i] == B_KING && b.side_to_move == BLACK)) {
-            std::vector<int> king_offsets = {-9, -8, -7, -1, 1, 7, 8, 9};
+// pseudo-legal moves of the piece on square i, if it belongs to the side to move
+void generate_square_moves(const Board& b, int i, std::vector<Move>& moves) {
+    if (b.side_to_move == WHITE) generate_square_moves<WHITE>(b, i, moves);
+    else generate_square_moves<BLACK>(b, i, moves);
+}
 
-            int start_file = i % 8;
+template <Color Us>
+static std::vector<Move> generate_pseudo_moves(const Board& b) {
+    PROFILE_SCOPE(PROBE_GENERATE_PSEUDO_MOVES);
 
-            for (int offset : king_offsets) {
-                int target = i + offset;
-                int target_file = target % 8;
+    std::vector<Move> moves;
 
-                if (target < 0 || target >= 64) continue;
-                if (std::abs(start_file - target_file) > 1) continue;
-                if (b.side_to_move == WHITE && W_PAWN <= b.board[target] && b.board[target] <= W_KING) continue;
-                if (b.side_to_move == BLACK && B_PAWN <= b.board[target] && b.board[target] <= B_KING) continue;
+    for (int i = 0; i < 64; i++) generate_square_moves<Us>(b, i, moves);
 
-                moves.push_back({i, target});
-            }
+    return moves;
+}
 
-            if (b.side_to_move == WHITE) {
-                if (b.castling_rights & CASTLE_WK)  { // white kingside
-                    if (b.board[square_to_index("h1")] == W_ROOK
-                     && b.board[square_to_index("f1")] == EMPTY
-                     && b.board[square_to_index("g1")] == EMPTY
-                     && !is_square_attacked(b, square_to_index("e1"), BLACK)
-                     && !is_square_attacked(b, square_to_index("f1"), BLACK)
-                     && !is_square_attacked(b, square_to_index("g1"), BLACK))
-                     moves.push_back({square_to_index("e1"), square_to_index("g1")});
-                }
+std::vector<Move> generate_pseudo_moves(const Board& b) {
+    return (b.side_to_move == WHITE) ? generate_pseudo_moves<WHITE>(b) : generate_pseudo_moves<BLACK>(b);
+}
 
-                if (b.castling_rights & CASTLE_WQ) {
-                    if (b.board[square_to_index("a1")] == W_ROOK
-                     && b.board[square_to_index("b1")] == EMPTY
-                     && b.board[square_to_index("c1")] == EMPTY
-                     && b.board[square_to_index("d1")] == EMPTY
-                     && !is_square_attacked(b, square_to_index("e1"), BLACK)
-                     && !is_square_attacked(b, square_to_index("d1"), BLACK)
-                     && !is_square_attacked(b, square_to_index("c1"), BLACK))
-                     moves.push_back({square_to_index("e1"), square_to_index("c1")});
-                }
-            } else {
-                if (b.castling_rights & CASTLE_BK)  { // black kingside
-                    if (b.board[square_to_index("h8")] == B_ROOK
-                     && b.board[square_to_index("f8")] == EMPTY
-                     && b.board[square_to_index("g8")] == EMPTY
-                     && !is_square_attacked(b, square_to_index("e8"), WHITE)
-                     && !is_square_attacked(b, square_to_index("f8"), WHITE)
-                     && !is_square_attacked(b, square_to_index("g8"), WHITE))
-                     moves.push_back({square_to_index("e8"), square_to_index("g8")});
-                }
+template <Color Us, GenType Gen>
+static void generate_into(const Board& b, std::vector<Move>& moves) {
+    for (int i = 0; i < 64; i++) generate_square_moves<Us, Gen>(b, i, moves);
+}
 
-                if (b.castling_rights & CASTLE_BQ) {
-                    if (b.board[square_to_index("a8")] == B_ROOK
-                     && b.board[square_to_index("b8")] == EMPTY
-                     && b.board[square_to_index("c8")] == EMPTY
-                     && b.board[square_to_index("d8")] == EMPTY
-                     && !is_square_attacked(b, square_to_index("e8"), WHITE)
-                     && !is_square_attacked(b, square_to_index("d8"), WHITE)
-                     && !is_square_attacked(b, square_to_index("c8"), WHITE))
-                     moves.push_back({square_to_index("e8"), square_to_index("c8")});
-                }
-            }
-        }
+void generate_captures(const Board& b, std::vector<Move>& moves) {
+    if (b.side_to_move == WHITE) generate_into<WHITE, GEN_CAPTURES>(b, moves);
+    else generate_into<BLACK, GEN_CAPTURES>(b, moves);
+}
 
-        if (!offsets.empty()) {
-            for (int offset : offsets) {
-                int target = i;
+void generate_quiets(const Board& b, std::vector<Move>& moves) {
+    if (b.side_to_move == WHITE) generate_into<WHITE, GEN_QUIETS>(b, moves);
+    else generate_into<BLACK, GEN_QUIETS>(b, moves);
+}
 
-                while (true) {
-                    target += offset;
+// same answer as looking for the move in generate_pseudo_moves, from the
+// geometry of the one move. only castling goes through the generator.
+template <Color Us>
+static bool is_pseudo_legal(const Board& b, Move move) {
+    using S = Side<Us>;
 
-                    if (target < 0 || target >= 64) break;
+    const int from = move.from;
+    const int to = move.to;
+    if (from < 0 || from >= 64 || to < 0 || to >= 64 || from == to) return false;
 
-                    int target_file = target % 8;
-                    if ((offset == -1 || offset == -9 || offset == 7) && target_file == 7) break; //wrap left
-                    if ((offset == 1 || offset == 9 || offset == -7 ) && target_file == 0) break; // wrap right
+    const Piece p = b.board[from];
+    if (!S::own(p) || S::own(b.board[to])) return false;
 
-                    if (b.board[target] == EMPTY) {
-                        moves.push_back({i, target});
-                        continue;
-                    }
+    const int df = to % 8 - from % 8;
+    const int dr = to / 8 - from / 8;
 
-                    if (b.side_to_move == WHITE &&  B_PAWN <= b.board[target] && b.board[target] <= B_KING) {
-                        moves.push_back({i, target});
-                        break;
-                    }
-                    if (b.side_to_move == BLACK && W_PAWN <= b.board[target] && b.board[target] <= W_KING) {
-                        moves.push_back({i, target});
-                        break;
-                    }
+    switch (static_cast<int>(p) - S::first) {
+    case W_PAWN:
+        if (df == 0) {
+            if (b.board[to] != EMPTY) return false;
+            if (to == from + S::up) return true;
+            return to == from + 2 * S::up && from / 8 == S::start_rank && b.board[from + S::up] == EMPTY;
+        }
+        return std::abs(df) == 1 && to == from + S::up + df &&
+               (b.board[to] != EMPTY || to == b.en_passant_square);
 
-                    break; // friendly piece
-                }
-            }
+    case W_KNIGHT:
+        return std::abs(df) * std::abs(dr) == 2;
+
+    case W_KING: {
+        if (std::abs(df) <= 1 && std::abs(dr) <= 1) return true;
+        if (from != S::home + 4 || (to != S::home + 6 && to != S::home + 2)) return false;
+
+        std::vector<Move> moves;
+        generate_square_moves<Us, GEN_QUIETS>(b, from, moves);
+        return std::find(moves.begin(), moves.end(), move) != moves.end();
+    }
+
+    default: { // rook, bishop, queen
+        const int kind = static_cast<int>(p) - S::first;
+        const bool straight = df == 0 || dr == 0;
+        const bool diagonal = std::abs(df) == std::abs(dr);
+
+        if (kind == W_ROOK && !straight) return false;
+        if (kind == W_BISHOP && !diagonal) return false;
+        if (!straight && !diagonal) return false;
+
+        const int step = ((dr > 0) - (dr < 0)) * 8 + ((df > 0) - (df < 0));
+        for (int sq = from + step; sq != to; sq += step) {
+            if (b.board[sq] != EMPTY) return false;
         }
+        return true;
+    }
     }
+}
 
-    return moves;
+bool is_pseudo_legal(const Board& b, Move move) {
+    return (b.side_to_move == WHITE) ? is_pseudo_legal<WHITE>(b, move) : is_pseudo_legal<BLACK>(b, move);
 }
 
-std::vector<Move> generate_moves(const Board& b) {
-    std::vector<Move> all_moves = generate_pseudo_moves(b);
+template <Color Us>
+static std::vector<Move> generate_moves(const Board& b) {
+    PROFILE_SCOPE(PROBE_GENERATE_MOVES);
+
+    std::vector<Move> all_moves = generate_pseudo_moves<Us>(b);
     std::vector<Move> legal_moves;
 
+    PROFILE_SCOPE(PROBE_LEGALITY_FILTER);
+
+    // one scratch copy, moves are made and taken back on it
+    Board temp = b;
+
     for (Move move : all_moves) {
-        Board temp = b;
-        make_move(temp, move);
+        UndoInfo undo = make_move<Us>(temp, move);
 
-        int king_sq = find_king(temp, b.side_to_move);
+        int king_sq = find_king(temp, Us);
 
-        if (!is_square_attacked(temp, king_sq, temp.side_to_move)) {
+        if (!attacked<Side<Us>::them>(temp, king_sq)) {
             legal_moves.push_back(move);
         }
+
+        unmake_move<Us>(temp, move, undo);
     }
 
     return legal_moves;
 }
 
-int search(Board& b, int depth, int alpha, int beta) {
-    if (depth == 0) return evaluate(b);
+std::vector<Move> generate_moves(const Board& b) {
+    return (b.side_to_move == WHITE) ? generate_moves<WHITE>(b) : generate_moves<BLACK>(b);
+}
 
-    std::vector<Move> moves = generate_moves(b);
+uint64_t position_key(const Board& b) {
+    // zobrist keys from a fixed splitmix64 stream, so keys are stable across runs
+    struct Keys {
+        uint64_t piece[12][64];
+        uint64_t black_to_move;
+        uint64_t castling[16];
+        uint64_t en_passant[64];
+    };
 
-    if (moves.empty()) {
-        int king_sq = find_king(b, b.side_to_move);
+    static const Keys keys = [] {
+        Keys k;
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        auto next = [&state] {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+        for (auto& piece : k.piece) for (auto& sq : piece) sq = next();
+        k.black_to_move = next();
+        for (auto& c : k.castling) c = next();
+        for (auto& ep : k.en_passant) ep = next();
+        return k;
+    }();
+
+    uint64_t key = 0;
+    for (int i = 0; i < 64; i++) {
+        if (b.board[i] != EMPTY) key ^= keys.piece[b.board[i]][i];
+    }
+    if (b.side_to_move == BLACK) key ^= keys.black_to_move;
+    key ^= keys.castling[b.castling_rights & 15];
+    if (b.en_passant_square >= 0) key ^= keys.en_passant[b.en_passant_square];
 
-        if (is_square_attacked(b, king_sq, b.side_to_move == WHITE ? BLACK : WHITE)) {
-            return (b.side_to_move == WHITE) ? -99999 : 99999; // checkmate
-        }
+    return key;
+}
+
+bool is_capture(const Board& b, Move move) {
+    if (b.board[move.to] != EMPTY) return true;
+
+    Piece p = b.board[move.from];
+    return (p == W_PAWN || p == B_PAWN) && move.to == b.en_passant_square;
+}
+
+// true once the search has to unwind. the clock is only read every 1024 nodes.
+static inline bool search_aborted(SearchContext* ctx) {
+    if (!ctx) return false;
+    if (ctx->aborted) return true;
+
+    if ((ctx->stop && ctx->stop->load(std::memory_order_relaxed)) ||
+        (ctx->max_nodes && ctx->nodes >= ctx->max_nodes) ||
+        ((ctx->nodes & 1023) == 0 && ctx->deadline != std::chrono::steady_clock::time_point::max() &&
+         std::chrono::steady_clock::now() >= ctx->deadline)) {
+        ctx->aborted = true;
+    }
+    return ctx->aborted;
+}
+
+// records the node in the trace, if there is one, and hands back score
+static inline int traced(SearchContext* ctx, int alpha, int beta, int score, TraceReason reason) {
+    if (ctx && ctx->trace) ctx->trace->record(alpha, beta, score, reason);
+    return score;
+}
 
-        return 0;
+// captures only, so the static eval at the horizon isn't taken in the middle
+// of an exchange. captures that lose material by SEE are never tried.
+static int quiesce(Board& b, int alpha, int beta, SearchContext* ctx) {
+    if (ctx) {
+        if (search_aborted(ctx)) return traced(ctx, alpha, beta, 0, TRACE_STOPPED);
+        ctx->nodes++;
     }
 
+    const int orig_alpha = alpha;
+    const int orig_beta = beta;
     const bool maximizing = (b.side_to_move == WHITE);
-    int best_score = maximizing ? -99999 : 99999;
+    int best_score = evaluate(b); // standing pat
 
-    for (auto move : moves) {
-        UndoInfo undo = make_move(b, move);
-        int score = search(b, depth - 1, alpha, beta);
-        unmake_move(b, move, undo);
+    if (maximizing) {
+        if (best_score >= beta) return traced(ctx, alpha, beta, best_score, TRACE_STAND_PAT);
+        if (best_score > alpha) alpha = best_score;
+    } else {
+        if (best_score <= alpha) return traced(ctx, alpha, beta, best_score, TRACE_STAND_PAT);
+        if (best_score < beta) beta = best_score;
+    }
+
+    std::vector<Move> moves;
+    generate_captures(b, moves);
+
+    std::vector<ScoredMove> captures;
+    for (Move move : moves) {
+        int gain = see(b, move);
+        if (gain >= 0) captures.push_back({move, gain});
+    }
+
+    std::stable_sort(captures.begin(), captures.end(),
+                     [](const ScoredMove& a, const ScoredMove& c) { return a.score > c.score; });
+
+    const Color us = b.side_to_move;
+    SearchTrace* trace = ctx ? ctx->trace : nullptr;
+
+    for (const auto& capture : captures) {
+        UndoInfo undo = make_move(b, capture.move);
+
+        // pseudo-legal, so skip anything that leaves our king hanging
+        if (is_square_attacked(b, find_king(b, us), b.side_to_move)) {
+            unmake_move(b, capture.move, undo);
+            continue;
+        }
+
+        if (trace) trace->push(capture.move);
+        int score = quiesce(b, alpha, beta, ctx);
+        if (trace) trace->pop();
+        unmake_move(b, capture.move, undo);
 
         if (maximizing) {
             if (score > best_score) best_score = score;
             if (score > alpha) alpha = score;
-            if (alpha >= beta) break;
-        }
-
-        else {
+        } else {
             if (score < best_score) best_score = score;
             if (score < beta) beta = score;
-            if (alpha >= beta) break;
         }
+        if (alpha >= beta) break;
     }
 
-    return best_score;
+    return traced(ctx, orig_alpha, orig_beta, best_score, captures.empty() ? TRACE_STAND_PAT : TRACE_QUIESCE);
 }
 
-Move get_best_move(Board& b, int depth) {
-    Move best_move = {0, 0};
-
-    std::vector<Move> moves = generate_moves(b);
-
-    if (moves.empty()) return best_move;
+int search(Board& b, int depth, int alpha, int beta, SearchContext* ctx) {
+    if (depth == 0) return quiesce(b, alpha, beta, ctx);
 
-    const bool maximizing = (b.side_to_move == WHITE);
+    if (ctx) {
+        if (search_aborted(ctx)) return traced(ctx, alpha, beta, 0, TRACE_STOPPED);
+        ctx->nodes++;
+    }
 
-    {
-        UndoInfo undo = make_move(b, moves[0]);
-        int score = search(b, depth - 1, -99999, 99999);
-        unmake_move(b, moves[0], undo);
-        best_move = moves[0];
-        int best_score = score;
-
-        for (size_t i = 1; i < moves.size(); i++) {
-            Move move = moves[i];
-            UndoInfo undo2 = make_move(b, move);
-            int score2 = search(b, depth - 1, -99999, 99999);
-            unmake_move(b, move, undo2);
-
-            if (maximizing) {
-                if (score2 > best_score) {
-                    best_score = score2;
-                    best_move = move;
-                }
-            } else {
-                if (score2 < best_score) {
-                    best_score = score2;
-                    best_move = move;
+    TranspositionTable* tt = ctx ? ctx->tt : nullptr;
+    uint64_t key = 0;
+    Move tt_move = {-1, -1};
+
+    if (tt) {
+        key = position_key(b);
+        TTEntry entry;
+        if (tt->probe(key, entry)) {
+            if (entry.depth >= depth) {
+                if (entry.bound == TT_EXACT ||
+                    (entry.bound == TT_LOWER && entry.score >= beta) ||
+                    (entry.bound == TT_UPPER && entry.score <= alpha)) {
+                    return traced(ctx, alpha, beta, entry.score, TRACE_HASH);
                 }
             }
+            tt_move = {entry.from, entry.to};
         }
     }
 
-    return best_move;
-}
+    const Color us = b.side_to_move;
+    const Color them = (us == WHITE) ? BLACK : WHITE;
+    const int our_king = find_king(b, us);
+    const bool in_check = is_square_attacked(b, our_king, them);
 
-Move parse_move(const std::string& input) {
-    Move move;
+    // close to the leaves, captures that lose material aren't worth a look
+    // unless we're in check
+    const bool prune_bad_captures = depth <= 2 && !in_check;
 
-    move.from = (input[0] - 'a') + ((input[1] - '1') * 8);
-    move.to = (input[2] - 'a') + ((input[3] - '1') * 8);
+    const bool killer_slot = ctx && ctx->ply < SearchContext::kMaxKillerPly;
+    MovePicker picker(b, tt_move, killer_slot ? ctx->killers[ctx->ply] : nullptr);
 
-    return move;
-}
+    const int orig_alpha = alpha;
+    const int orig_beta = beta;
+    const bool maximizing = (us == WHITE);
+    int best_score = maximizing ? -99999 : 99999;
+    Move best_move = {-1, -1};
+    int legal = 0;
+    SearchTrace* trace = ctx ? ctx->trace : nullptr;
 
-bool is_square_attacked(const Board& b, int square, Color side_attacking) {
-    int file = square % 8;
+    Move move;
+    while (picker.next(move)) {
+        // always search at least one move so the score stays real
+        if (legal > 0 && prune_bad_captures && picker.stage() == PICK_BAD_CAPTURES) break;
 
-    // pawn checks
-    if (side_attacking == WHITE) {
-        // white pawns attack diagonally up,
-        // so we check squares below
+        const bool capture = is_capture(b, move);
+        UndoInfo undo = make_move(b, move);
 
-        if (file != 0 && square - 9 >= 0) { // down-left
-            if (b.board[square - 9] == W_PAWN) return true;
+        // pseudo-legal, so skip anything that leaves our king hanging
+        const int king_sq = (move.from == our_king) ? move.to : our_king;
+        if (is_square_attacked(b, king_sq, them)) {
+            unmake_move(b, move, undo);
+            continue;
         }
+        if (legal++ == 0) best_move = move;
+
+        if (ctx) ctx->ply++;
+        if (trace) trace->push(move);
+        int score = search(b, depth - 1, alpha, beta, ctx);
+        if (trace) trace->pop();
+        if (ctx) ctx->ply--;
+        unmake_move(b, move, undo);
 
-        if (file != 7 && square - 7 >= 0) { // down-right
-            if (b.board[square - 7] == W_PAWN) return true;
+        if (maximizing) {
+            if (score > best_score) { best_score = score; best_move = move; }
+            if (score > alpha) alpha = score;
         }
-    } else {
-        // black pawns attack diagonally down,
-        // so we check squares above
 
-        if (file != 0 && square + 7 < 64 ) { // up-left
-            if (b.board[square + 7] == B_PAWN) return true;
+        else {
+            if (score < best_score) { best_score = score; best_move = move; }
+            if (score < beta) beta = score;
         }
 
-        if (file != 7 && square + 9 < 64) { // up-right
-            if (b.board[square + 9] == B_PAWN) return true;
+        if (alpha >= beta) {
+            if (killer_slot && !capture) {
+                Move* killers = ctx->killers[ctx->ply];
+                if (!(killers[0] == move)) {
+                    killers[1] = killers[0];
+                    killers[0] = move;
+                }
+            }
+            break;
         }
     }
 
-    // knight checks
+    if (legal == 0) {
+        if (in_check) return traced(ctx, alpha, beta, maximizing ? -99999 : 99999, TRACE_MATE); // checkmate
 
-    std::vector<int> knight_offsets = {-17, -15, -10, -6, 6, 10, 15, 17};
+        return traced(ctx, alpha, beta, 0, TRACE_STALEMATE);
+    }
 
-    for (int offset : knight_offsets) {
-        int target = square + offset;
-        int target_file = target % 8;
+    const bool stopped = ctx && ctx->aborted;
 
-        if (target < 0 || target >= 64) continue;
-        if (std::abs(file - target_file) > 2) continue; // wrap around check
+    if (tt && !stopped) {
+        TTBound bound = TT_EXACT;
+        if (best_score <= orig_alpha) bound = TT_UPPER;
+        else if (best_score >= orig_beta) bound = TT_LOWER;
+        tt->store(key, depth, best_score, bound, best_move);
+    }
 
-        if (side_attacking == WHITE && b.board[target] == W_KNIGHT) return true;
-        if (side_attacking == BLACK && b.board[target] == B_KNIGHT) return true;
+    if (trace) {
+        TraceReason reason = TRACE_EXACT;
+        if (stopped) reason = TRACE_STOPPED;
+        else if (alpha >= beta) reason = TRACE_CUTOFF;
+        else if (maximizing ? best_score <= orig_alpha : best_score >= orig_beta) reason = TRACE_FAIL_LOW;
+        trace->record(orig_alpha, orig_beta, best_score, reason);
     }
 
-    // sliding pieces
+    return best_score;
+}
 
-    // check for rook / queen
+std::vector<RootLine> search_root(Board& b, int depth, int multi_pv, SearchContext* ctx) {
+    std::vector<RootLine> lines;
 
-    std::vector<int> rook_offsets = {-8, 8, -1, 1};
+    std::vector<Move> moves = generate_moves(b);
 
-    for (int offset : rook_offsets) {
-        int target = square;
+    if (moves.empty() || multi_pv < 1) return lines;
 
-        while (true) {
-            target += offset;
+    if (ctx && ctx->tt) {
+        TTEntry entry;
+        if (ctx->tt->probe(position_key(b), entry)) {
+            auto it = std::find(moves.begin(), moves.end(), Move{entry.from, entry.to});
+            if (it != moves.end()) std::rotate(moves.begin(), it, it + 1);
+        }
+    }
 
-            if (target < 0 || target >= 64) break;
+    const bool maximizing = (b.side_to_move == WHITE);
 
-            int target_file = target % 8;
+    // true if score a ranks ahead of score c for the side to move
+    auto better = [maximizing](int a, int c) { return maximizing ? a > c : a < c; };
 
-            // wrap check for horizontal movement
+    SearchTrace* trace = ctx ? ctx->trace : nullptr;
 
-            if (offset == -1 && target_file == 7) break; // wrap left
-            if (offset == 1 && target_file == 0) break; // wrap right
+    for (auto move : moves) {
+        const bool full = static_cast<int>(lines.size()) >= multi_pv;
+
+        // once we hold multi_pv lines, the worst of them bounds the window.
+        // moves that can't beat it fail low and never get an exact score.
+        int alpha = -99999;
+        int beta = 99999;
+        if (full) {
+            if (maximizing) alpha = lines.back().score;
+            else beta = lines.back().score;
+        }
 
-            if (b.board[target] == EMPTY) continue;
+        UndoInfo undo = make_move(b, move);
+        if (ctx) ctx->ply++;
+        if (trace) trace->push(move);
+        int score = search(b, depth - 1, alpha, beta, ctx);
+        if (trace) trace->pop();
+        if (ctx) ctx->ply--;
+        unmake_move(b, move, undo);
 
-            // hit a piece
+        if (full && !better(score, lines.back().score)) continue;
 
-            if (side_attacking == WHITE) {
-                if (b.board[target] == W_ROOK || b.board[target] == W_QUEEN) return true;
-            } else {
-                if (b.board[target] == B_ROOK || b.board[target] == B_QUEEN) return true;
-            }
+        auto pos = std::find_if(lines.begin(), lines.end(),
+                                [&](const RootLine& line) { return better(score, line.score); });
+        lines.insert(pos, {move, score});
 
-            break; // hit a piece thats not attacking, stop sliding
-        }
+        if (static_cast<int>(lines.size()) > multi_pv) lines.pop_back();
     }
 
-    // check for bishop / queen
+    const bool stopped = ctx && ctx->aborted;
 
-    std::vector<int> bishop_offsets = {-9, -7, 7, 9};
+    if (ctx && ctx->tt && !stopped) {
+        ctx->tt->store(position_key(b), depth, lines[0].score, TT_EXACT, lines[0].move);
+    }
 
-    for (int offset : bishop_offsets) {
-        int target = square;
+    if (trace) trace->record(-99999, 99999, lines[0].score, stopped ? TRACE_STOPPED : TRACE_ROOT);
 
-        while (true) {
-            target += offset;
+    return lines;
+}
 
-            if (target < 0 || target >= 64) break;
+Move get_best_move(Board& b, int depth) {
+    std::vector<RootLine> lines = search_root(b, depth, 1);
 
-            int target_file = target % 8;
+    if (lines.empty()) return {0, 0};
 
-            if ((offset == -9 || offset == 7) && target_file == 7) break;
-            if ((offset == -7 || offset == 9) && target_file == 0) break;
+    return lines[0].move;
+}
+
+Move parse_move(const std::string& input) {
+    Move move;
 
-            if (b.board[target] == EMPTY) continue;
+    move.from = (input[0] - 'a') + ((input[1] - '1') * 8);
+    move.to = (input[2] - 'a') + ((input[3] - '1') * 8);
 
-            if (side_attacking == WHITE) {
-                if (b.board[target] == W_BISHOP || b.board[target] == W_QUEEN) return true;
-            } else {
-                if (b.board[target] == B_BISHOP || b.board[target] == B_QUEEN) return true;
-            }
+    return move;
+}
 
-            break;
+int see(const Board& b, Move move) {
+    std::array<Piece, 64> board = b.board;
+    const int to = move.to;
+
+    Piece piece = board[move.from];
+    if (piece == EMPTY) return 0;
+
+    Color side = (piece <= W_KING) ? WHITE : BLACK;
+
+    int gain[32];
+    int d = 0;
+
+    gain[0] = get_piece_value(board[to]);
+
+    // en passant takes a pawn that isn't on the target square
+    if ((piece == W_PAWN || piece == B_PAWN) && to == b.en_passant_square && board[to] == EMPTY) {
+        gain[0] = get_piece_value(W_PAWN);
+        board[side == WHITE ? to - 8 : to + 8] = EMPTY;
+    }
+
+    // promotions always make a queen
+    auto promoted = [to](Piece p) {
+        if (p == W_PAWN && to / 8 == 7) return W_QUEEN;
+        if (p == B_PAWN && to / 8 == 0) return B_QUEEN;
+        return p;
+    };
+
+    if (promoted(piece) != piece) gain[0] += get_piece_value(W_QUEEN) - get_piece_value(W_PAWN);
+
+    piece = promoted(piece);
+    board[to] = piece;
+    board[move.from] = EMPTY;
+
+    while (d < 31) {
+        side = (side == WHITE) ? BLACK : WHITE;
+
+        int from = least_valuable_attacker(board, to, side);
+        if (from < 0) break;
+
+        Piece attacker = board[from];
+
+        // a king can only recapture onto an undefended square
+        if (attacker == W_KING || attacker == B_KING) {
+            board[from] = EMPTY;
+            if (least_valuable_attacker(board, to, side == WHITE ? BLACK : WHITE) >= 0) break;
         }
+
+        Piece landed = promoted(attacker);
+
+        d++;
+        gain[d] = get_piece_value(piece) - gain[d - 1];
+        if (landed != attacker) gain[d] += get_piece_value(W_QUEEN) - get_piece_value(W_PAWN);
+
+        piece = landed;
+        board[to] = landed;
+        board[from] = EMPTY;
     }
 
-    std::vector<int> king_offsets = {-9, -8, -7, -1, 1, 7, 8, 9};
+    while (d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
 
-    for (int offset : king_offsets) {
-        int target = square + offset;
+    return gain[0];
+}
 
-        int target_file = target % 8;
+bool is_valid_fen(std::string_view fen) {
+    const std::string full(fen);
 
-        if (target < 0 || target >= 64) continue;
-        if (std::abs(file - target_file) > 1) continue;
+    std::string_view fields[4];
+    for (auto& field : fields) {
+        const size_t space = fen.find(' ');
+        field = fen.substr(0, space);
+        if (field.empty()) return false;
+        fen.remove_prefix(space == std::string_view::npos ? fen.size() : space + 1);
+    }
 
-        if (side_attacking == WHITE && b.board[target] == W_KING) return true;
-        if (side_attacking == BLACK && b.board[target] == B_KING) return true;
+    int ranks = 1;
+    int files = 0;
+    int white_kings = 0;
+    int black_kings = 0;
+    for (char c : fields[0]) {
+        if (c == '/') {
+            if (files != 8) return false;
+            ranks++;
+            files = 0;
+        } else if (c >= '1' && c <= '8') {
+            files += c - '0';
+        } else if (c != '\0' && std::strchr("pnbrqkPNBRQK", c)) {
+            if (c == 'K') white_kings++;
+            if (c == 'k') black_kings++;
+            files++;
+        } else {
+            return false;
+        }
+        if (files > 8) return false;
     }
+    if (ranks != 8 || files != 8 || white_kings != 1 || black_kings != 1) return false;
+
+    if (fields[1] != "w" && fields[1] != "b") return false;
+    if (fields[2].find_first_not_of("KQkq-") != std::string_view::npos) return false;
+
+    // en passant is only ever the square behind a pawn that just double pushed
+    const std::string_view ep = fields[3];
+    const char ep_rank = (fields[1] == "w") ? '6' : '3';
+    if (ep != "-" && !(ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] == ep_rank)) return false;
 
-    return false;
+    // the side that just moved can't have left its king to be taken
+    Board b;
+    load_fen(b, full);
+    const Color moved = (b.side_to_move == WHITE) ? BLACK : WHITE;
+    return !is_square_attacked(b, find_king(b, moved), b.side_to_move);
 }
 
 void load_fen(Board& b, const std::string& fen) {
@@ -736,4 +1341,42 @@ void load_fen(Board& b, const std::string& fen) {
 
         b.en_passant_square = square_to_index(en_passant);
     }
+
+    refresh_attacks(b);
+}
+
+std::string to_fen(const Board& b) {
+    std::string fen;
+
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            Piece p = b.board[rank * 8 + file];
+            if (p == EMPTY) {
+                empty++;
+                continue;
+            }
+            if (empty) fen += static_cast<char>('0' + empty);
+            empty = 0;
+            fen += get_piece_char(p);
+        }
+        if (empty) fen += static_cast<char>('0' + empty);
+        if (rank > 0) fen += '/';
+    }
+
+    fen += (b.side_to_move == WHITE) ? " w " : " b ";
+
+    if (b.castling_rights == 0) fen += '-';
+    if (b.castling_rights & CASTLE_WK) fen += 'K';
+    if (b.castling_rights & CASTLE_WQ) fen += 'Q';
+    if (b.castling_rights & CASTLE_BK) fen += 'k';
+    if (b.castling_rights & CASTLE_BQ) fen += 'q';
+
+    fen += ' ';
+    fen += (b.en_passant_square >= 0) ? index_to_square(b.en_passant_square) : "-";
+
+    // the board doesn't track move clocks
+    fen += " 0 1";
+
+    return fen;
 }
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <chrono>
+
+#include "include/engine.h"
+
+Engine::Engine(size_t hash_mb) : tt_(hash_mb) {
+    init_board(board_);
+}
+
+Engine::~Engine() {
+    stop();
+    wait();
+}
+
+void Engine::new_game() {
+    wait();
+    init_board(board_);
+    tt_.clear();
+}
+
+bool Engine::set_position(const std::string& fen, const std::vector<std::string>& moves) {
+    wait();
+
+    // built on a copy, so a bad fen or move leaves the current position alone
+    Board b;
+    if (fen == "startpos") init_board(b);
+    else if (is_valid_fen(fen)) load_fen(b, fen);
+    else return false;
+
+    for (const auto& m : moves) {
+        // coordinate notation, a fifth letter for the promotion piece is
+        // ignored since promotions are always to a queen
+        if (m.size() != 4 && m.size() != 5) return false;
+
+        bool legal = false;
+        for (Move move : generate_moves(b)) {
+            if (m.compare(0, 4, index_to_square(move.from) + index_to_square(move.to)) == 0) {
+                make_move(b, move);
+                legal = true;
+                break;
+            }
+        }
+        if (!legal) return false;
+    }
+
+    board_ = b;
+    return true;
+}
+
+void Engine::set_position(const Board& board) {
+    wait();
+    board_ = board;
+}
+
+bool Engine::set_option(const std::string& name, const std::string& value) {
+    int n = 0;
+    try {
+        n = std::stoi(value);
+    } catch (...) {
+        return false;
+    }
+
+    if (name == "Hash") {
+        wait();
+        tt_.resize(static_cast<size_t>(std::clamp(n, 1, 1024)));
+        return true;
+    }
+    if (name == "MultiPV") {
+        multi_pv_ = std::clamp(n, 1, 256);
+        return true;
+    }
+
+    return false;
+}
+
+bool Engine::set_trace(const std::string& path) {
+    wait();
+    trace_ = nullptr;
+    trace_writer_.close();
+
+    if (path.empty()) return true;
+    if (!trace_writer_.open(path)) return false;
+
+    trace_ = trace_writer_.add_thread();
+    return true;
+}
+
+// position keys come from a fixed random stream, so the start position's
+// key changes exactly when the key scheme does
+static uint64_t key_scheme() {
+    Board b;
+    init_board(b);
+    return position_key(b);
+}
+
+bool Engine::save_hash(const std::string& path, std::string& error) {
+    wait();
+    return tt_.save(path, key_scheme(), evaluation_fingerprint(), error);
+}
+
+bool Engine::load_hash(const std::string& path, std::string& error) {
+    wait();
+    return tt_.load(path, key_scheme(), evaluation_fingerprint(), error);
+}
+
+SearchResult Engine::run(const SearchLimits& limits, const std::function<void(const SearchResult&)>& on_iteration) {
+    SearchResult result;
+    Board b = board_;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int d = 1; d <= limits.depth; d++) {
+        if (d > 1 && limits.nodes && result.nodes >= limits.nodes) break;
+
+        SearchContext ctx;
+        ctx.tt = &tt_;
+        ctx.trace = trace_;
+        // depth 1 always finishes so a stopped search still has a move
+        if (d > 1) {
+            ctx.stop = &stop_;
+            if (limits.nodes) ctx.max_nodes = limits.nodes - result.nodes;
+            if (limits.movetime_ms) ctx.deadline = start + std::chrono::milliseconds(limits.movetime_ms);
+        }
+
+        std::vector<RootLine> lines = search_root(b, d, multi_pv_, &ctx);
+        result.nodes += ctx.nodes;
+
+        if (ctx.aborted) break;
+
+        result.lines = std::move(lines);
+        result.depth = d;
+        if (on_iteration) on_iteration(result);
+        if (result.lines.empty()) break;
+    }
+
+    return result;
+}
+
+SearchResult Engine::search(int depth) {
+    SearchLimits limits;
+    limits.depth = depth;
+    return search(limits);
+}
+
+SearchResult Engine::search(const SearchLimits& limits, const std::function<void(const SearchResult&)>& on_iteration) {
+    wait();
+    clear_stop();
+    return run(limits, on_iteration);
+}
+
+MateResult Engine::find_mate(int moves) {
+    wait();
+    clear_stop();
+
+    Board b = board_;
+    return mate_search(b, moves, &stop_);
+}
+
+void Engine::start(int depth, std::function<void(const SearchResult&)> on_done) {
+    wait();
+    clear_stop();
+    searching_ = true;
+
+    worker_ = std::thread([this, depth, on_done] {
+        SearchLimits limits;
+        limits.depth = depth;
+        SearchResult result = run(limits, {});
+        {
+            std::lock_guard<std::mutex> lock(result_mutex_);
+            result_ = result;
+        }
+        searching_ = false;
+        if (on_done) on_done(result);
+    });
+}
+
+void Engine::stop() {
+    stops_++;
+    stop_ = true;
+}
+
+void Engine::arm_stop() {
+    armed_stops_ = stops_.load();
+    armed_ = true;
+}
+
+void Engine::clear_stop() {
+    stop_ = false;
+    // a stop that came in after arm_stop, before this search began, still
+    // counts. stops_ is bumped before stop_ is set, so one racing with the
+    // clear either shows up here or sets stop_ after it.
+    if (armed_ && stops_.load() != armed_stops_) stop_ = true;
+    armed_ = false;
+}
+
+SearchResult Engine::wait() {
+    if (worker_.joinable()) worker_.join();
+
+    std::lock_guard<std::mutex> lock(result_mutex_);
+    return result_;
+}
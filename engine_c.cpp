@@ -0,0 +1,100 @@
+#include <cstring>
+#include <sstream>
+
+#include "include/chess_engine.h"
+#include "include/engine.h"
+
+struct chess_engine {
+    Engine engine;
+};
+
+// fills the C out-params from a search result. score is from the side to move.
+static int write_result(const chess_engine* e, const SearchResult& result, char* best_move, int* score_cp) {
+    if (result.lines.empty()) {
+        if (best_move) std::strcpy(best_move, "0000");
+        if (score_cp) *score_cp = 0;
+        return 0;
+    }
+
+    const RootLine& line = result.lines[0];
+    if (best_move) {
+        std::string m = index_to_square(line.move.from) + index_to_square(line.move.to);
+        std::strcpy(best_move, m.c_str());
+    }
+    if (score_cp) *score_cp = is_white_turn(e->engine.board()) ? line.score : -line.score;
+    return 0;
+}
+
+extern "C" {
+
+chess_engine* chess_engine_new(void) {
+    try {
+        return new chess_engine;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void chess_engine_free(chess_engine* engine) {
+    delete engine;
+}
+
+int chess_engine_new_game(chess_engine* engine) {
+    if (!engine) return -1;
+    engine->engine.new_game();
+    return 0;
+}
+
+int chess_engine_set_position(chess_engine* engine, const char* fen, const char* moves) {
+    if (!engine) return -1;
+
+    try {
+        std::vector<std::string> move_list;
+        if (moves) {
+            std::istringstream iss(moves);
+            std::string tok;
+            while (iss >> tok) move_list.push_back(tok);
+        }
+        if (!engine->engine.set_position(fen ? fen : "startpos", move_list)) return -1;
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int chess_engine_set_option(chess_engine* engine, const char* name, const char* value) {
+    if (!engine || !name || !value) return -1;
+    return engine->engine.set_option(name, value) ? 0 : -1;
+}
+
+int chess_engine_search(chess_engine* engine, int depth, char* best_move, int* score_cp) {
+    if (!engine || depth < 1) return -1;
+
+    try {
+        return write_result(engine, engine->engine.search(depth), best_move, score_cp);
+    } catch (...) {
+        return -1;
+    }
+}
+
+int chess_engine_start(chess_engine* engine, int depth) {
+    if (!engine || depth < 1) return -1;
+
+    try {
+        engine->engine.start(depth);
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+void chess_engine_stop(chess_engine* engine) {
+    if (engine) engine->engine.stop();
+}
+
+int chess_engine_wait(chess_engine* engine, char* best_move, int* score_cp) {
+    if (!engine) return -1;
+    return write_result(engine, engine->engine.wait(), best_move, score_cp);
+}
+
+}
@@ -2,7 +2,11 @@
 #define BOARD_H
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "types.h"
@@ -23,6 +27,44 @@ struct Board {
     Color side_to_move;
     int castling_rights;
     int en_passant_square = -1;
+
+#ifdef CHESS_ATTACK_MAPS
+    // attack maps per side, kept current by make_move/unmake_move in the
+    // `make attackmaps` build. code that writes board directly must call
+    // refresh_attacks after.
+    std::array<std::array<uint8_t, 64>, 2> attackers{}; // how many pieces attack each square
+    std::array<uint64_t, 2> attacked{};                  // squares with at least one attacker
+#endif
+};
+
+class TranspositionTable;
+class SearchTrace;
+
+// per-search state threaded through search(). everything is optional, so a
+// null context searches exactly like a bare search() call.
+struct SearchContext {
+    TranspositionTable* tt = nullptr;
+    const std::atomic<bool>* stop = nullptr; // polled at every node
+    uint64_t nodes = 0;
+    SearchTrace* trace = nullptr; // records every node when set
+
+    uint64_t max_nodes = 0; // 0 for no limit
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+    // set once stop, max_nodes or deadline ends the search. scores from an
+    // aborted search are meaningless.
+    bool aborted = false;
+
+    // distance from the root, and the last two quiet moves that caused a
+    // cutoff at each ply (from == to for an empty slot)
+    int ply = 0;
+    static constexpr int kMaxKillerPly = 64;
+    Move killers[kMaxKillerPly][2] = {};
+};
+
+struct RootLine {
+    Move move;
+    int score; // white's point of view, same as search()
 };
 
 void init_board(Board& board);
@@ -30,18 +72,36 @@ char get_piece_char(Piece p);
 Piece get_piece_from_char(char c);
 int get_piece_value(Piece p);
 int evaluate(const Board& board);
+uint64_t evaluation_fingerprint(); // changes whenever the tables in pst_tables.h do
 void print_board(const Board& board);
 bool is_white_turn(const Board& board);
 UndoInfo make_move(Board& board, Move move);
 void unmake_move(Board& board, Move move, const UndoInfo& state);
 int find_king(const Board& board, Color side);
+void generate_square_moves(const Board& board, int square, std::vector<Move>& moves);
 std::vector<Move> generate_pseudo_moves(const Board& board);
+void generate_captures(const Board& board, std::vector<Move>& moves); // appends, en passant included
+void generate_quiets(const Board& board, std::vector<Move>& moves);   // appends, castling and promotion pushes included
+bool is_pseudo_legal(const Board& board, Move move); // true if generate_pseudo_moves would list it
+bool is_capture(const Board& board, Move move);
 std::vector<Move> generate_moves(const Board& board);
-int search(Board& board, int depth, int alpha, int beta);
+int search(Board& board, int depth, int alpha, int beta, SearchContext* ctx = nullptr);
 Move get_best_move(Board& board, int depth);
+std::vector<RootLine> search_root(Board& board, int depth, int multi_pv, SearchContext* ctx = nullptr);
+uint64_t position_key(const Board& board);
 Move parse_move(const std::string& input);
-bool is_square_attacked(const Board& board, int square, Color side_attacking);
+bool is_square_attacked(const Board& board, int square, Color side_attacking); // a lookup with attack maps
+bool scan_square_attacked(const Board& board, int square, Color side_attacking); // always from scratch
+void refresh_attacks(Board& board); // rebuilds the attack maps, if the build has them
+int see(const Board& board, Move move);
+// load_fen trusts its input. anything from outside (files, clients) goes
+// through is_valid_fen first: 8 ranks of 8 squares, known pieces, one king
+// per side, w or b, castling letters, an en passant square on the rank
+// behind a double push, and the side that just moved not in check. the move
+// counters are optional.
+bool is_valid_fen(std::string_view fen);
 void load_fen(Board& board, const std::string& fen);
+std::string to_fen(const Board& board);
 
 
 
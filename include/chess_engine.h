@@ -0,0 +1,37 @@
+#ifndef CHESS_ENGINE_H
+#define CHESS_ENGINE_H
+
+/* thin C interface over Engine. every handle is independent.
+   functions returning int give 0 on success and -1 on failure.
+   moves are written as coordinate notation into a buffer of at least 6 chars,
+   "0000" when there is no legal move. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct chess_engine chess_engine;
+
+chess_engine* chess_engine_new(void);
+void chess_engine_free(chess_engine* engine);
+
+int chess_engine_new_game(chess_engine* engine);
+
+/* fen may be NULL or "startpos". moves is a space separated list or NULL.
+   returns -1, keeping the old position, for a malformed fen or illegal move. */
+int chess_engine_set_position(chess_engine* engine, const char* fen, const char* moves);
+int chess_engine_set_option(chess_engine* engine, const char* name, const char* value);
+
+/* blocking search */
+int chess_engine_search(chess_engine* engine, int depth, char* best_move, int* score_cp);
+
+/* background search: start, optionally stop, then wait for the result */
+int chess_engine_start(chess_engine* engine, int depth);
+void chess_engine_stop(chess_engine* engine);
+int chess_engine_wait(chess_engine* engine, char* best_move, int* score_cp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "mate.h"
+#include "trace.h"
+#include "tt.h"
+
+struct SearchResult {
+    std::vector<RootLine> lines; // best first, empty if there are no legal moves
+    int depth = 0;               // last fully completed iteration
+    uint64_t nodes = 0;
+};
+
+// a search ends at whichever limit it reaches first. depth 1 always
+// completes, so there is a move even if a limit is hit right away.
+struct SearchLimits {
+    int depth = 64;
+    uint64_t nodes = 0;      // 0 for no limit
+    int64_t movetime_ms = 0; // 0 for no limit
+};
+
+// one independent engine: its own board, hash table, options and search
+// thread. engines share nothing, so any number can live in one process.
+class Engine {
+public:
+    explicit Engine(size_t hash_mb = 16);
+    ~Engine();
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    void new_game();
+
+    // fen may be "startpos". moves are in coordinate notation (e2e4).
+    // returns false, keeping the old position, for a fen that is_valid_fen
+    // refuses or a move that isn't legal where it is played.
+    bool set_position(const std::string& fen, const std::vector<std::string>& moves = {});
+    void set_position(const Board& board);
+
+    // returns false for unknown options or bad values
+    bool set_option(const std::string& name, const std::string& value);
+
+    // write every node of later searches to path (see trace.h).
+    // an empty path stops tracing and closes the file.
+    bool set_trace(const std::string& path);
+
+    // transposition table snapshots (see TranspositionTable::save/load).
+    // error says what went wrong when they return false.
+    bool save_hash(const std::string& path, std::string& error);
+    bool load_hash(const std::string& path, std::string& error);
+
+    const Board& board() const { return board_; }
+    int multi_pv() const { return multi_pv_; }
+
+    // blocking search, iterating up to depth
+    SearchResult search(int depth);
+
+    // blocking search under limits. on_iteration sees the result after every
+    // completed iteration, nodes counting all iterations so far.
+    SearchResult search(const SearchLimits& limits,
+                        const std::function<void(const SearchResult&)>& on_iteration = {});
+
+    // blocking mate search, only checks for the side to move
+    MateResult find_mate(int moves);
+
+    // background search. on_done runs on the search thread when it finishes.
+    void start(int depth, std::function<void(const SearchResult&)> on_done = {});
+    void stop();
+    // the next search also honours a stop() that arrives between now and
+    // its start, instead of clearing it. for callers that queue searches.
+    void arm_stop();
+    SearchResult wait();
+    bool searching() const { return searching_.load(); }
+
+private:
+    SearchResult run(const SearchLimits& limits, const std::function<void(const SearchResult&)>& on_iteration);
+    void clear_stop();
+
+    Board board_;
+    TranspositionTable tt_;
+    int multi_pv_ = 1;
+    TraceWriter trace_writer_;
+    SearchTrace* trace_ = nullptr;
+
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> stops_{0}; // stop() calls so far
+    uint64_t armed_stops_ = 0;
+    bool armed_ = false;
+    std::atomic<bool> searching_{false};
+    std::thread worker_;
+    std::mutex result_mutex_;
+    SearchResult result_;
+};
+
+#endif
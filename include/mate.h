@@ -0,0 +1,28 @@
+#ifndef MATE_H
+#define MATE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+
+struct MateResult {
+    Move move = {0, 0}; // first move of the mate, {0, 0} if none was found
+    int mate_in = 0;    // in moves of the side to move, 0 if none was found
+    uint64_t nodes = 0;
+};
+
+// legal moves that give check. only pieces that can reach a direct-check
+// square or uncover a slider on the enemy king are generated at all.
+std::vector<Move> generate_checks(const Board& board);
+
+// legal moves for a side in check: king moves, and with a single checker,
+// captures of it or blocks on the line to the king.
+std::vector<Move> generate_evasions(const Board& board);
+
+// looks for a forced mate in at most max_moves moves for the side to move,
+// trying only checks for the attacker. returns the shortest one found.
+MateResult mate_search(Board& board, int max_moves, const std::atomic<bool>* stop = nullptr);
+
+#endif
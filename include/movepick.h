@@ -0,0 +1,60 @@
+#ifndef MOVEPICK_H
+#define MOVEPICK_H
+
+#include <cstddef>
+#include <vector>
+
+#include "board.h"
+
+struct ScoredMove {
+    Move move;
+    int score;
+};
+
+// the stages a MovePicker hands out moves in, in this order
+enum PickStage {
+    PICK_HASH,          // the transposition table move, if it's pseudo-legal here
+    PICK_GOOD_CAPTURES, // captures that don't lose material by SEE, best first
+    PICK_KILLERS,       // quiet moves that cut off at this ply elsewhere in the tree
+    PICK_QUIETS,        // the remaining quiets, in generation order
+    PICK_BAD_CAPTURES,  // captures that lose material, least bad first
+    PICK_DONE,
+};
+
+constexpr int kKillerSlots = 2;
+
+// hands out the pseudo-legal moves of a position one at a time. each stage
+// is only generated once the stages before it are used up, so a node that
+// cuts off on the hash move or a capture never generates its quiets.
+// legality is left to the caller, after make_move.
+class MovePicker {
+public:
+    // killers may be null, or point at kKillerSlots moves (from == to for none)
+    MovePicker(const Board& b, Move hash_move, const Move* killers = nullptr);
+
+    // false once every stage is used up
+    bool next(Move& move);
+
+    // stage of the move next() handed out last
+    PickStage stage() const { return stage_; }
+
+private:
+    bool already_tried(Move move) const;
+    // takes the best scored move left in list from index cursor_ on
+    Move select_best(std::vector<ScoredMove>& list);
+
+    const Board& board_;
+    Move hash_move_;
+    Move killers_[kKillerSlots];
+    bool hash_valid_ = false;
+
+    PickStage stage_ = PICK_HASH;
+    bool generated_ = false; // the current stage's list is filled in
+    size_t cursor_ = 0;
+
+    std::vector<ScoredMove> captures_;
+    std::vector<ScoredMove> bad_captures_;
+    std::vector<Move> quiets_;
+};
+
+#endif
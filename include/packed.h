@@ -0,0 +1,59 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "board.h"
+
+// 32-byte canonical position: occupancy bitmap, then one 4-bit Piece per
+// occupied square in square order, then side, castling and en passant.
+// castling rights whose king or rook has left home and en passant squares
+// no pawn can take on are dropped, so equal positions pack to equal bytes.
+struct PackedPosition {
+    uint64_t occupancy;
+    uint8_t pieces[16]; // low nibble first
+    uint8_t flags;      // bit 0: black to move, bits 1-4: castling rights
+    int8_t en_passant;  // square, or -1
+    uint8_t pad[6];     // always zero
+
+    bool operator==(const PackedPosition& other) const {
+        return std::memcmp(this, &other, sizeof(PackedPosition)) == 0;
+    }
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+// binary position files start with this, followed by PackedPosition records
+constexpr char kPackedMagic[8] = {'C', 'E', 'P', 'O', 'S', '0', '1', '\n'};
+
+PackedPosition pack_position(const Board& board);
+
+// returns false for records that can't be a position (bad nibble, too many
+// pieces, not one king a side, the side that moved in check)
+bool unpack_position(const PackedPosition& packed, Board& board);
+
+uint64_t packed_hash(const PackedPosition& packed);
+
+// open-addressing set of packed positions with linear probing. slots with
+// zero occupancy are empty, which no real position has.
+class PositionSet {
+public:
+    explicit PositionSet(size_t expected = 1024);
+
+    // true if the position wasn't in the set yet
+    bool insert(const PackedPosition& packed);
+    bool contains(const PackedPosition& packed) const;
+
+    size_t size() const { return count_; }
+
+private:
+    void grow();
+
+    std::vector<PackedPosition> slots_;
+    size_t mask_ = 0;
+    size_t count_ = 0;
+};
+
+#endif
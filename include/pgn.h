@@ -0,0 +1,47 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "board.h"
+
+enum GameResult {
+    RESULT_WHITE_WIN,
+    RESULT_BLACK_WIN,
+    RESULT_DRAW,
+    RESULT_UNKNOWN
+};
+
+// one replayed move: the position before it, the move and the game's result
+struct PgnRecord {
+    const Board* board;
+    Move move;
+    GameResult result;
+    int thread; // which worker produced it, for per-thread output buffers
+};
+
+struct PgnStats {
+    uint64_t games = 0;
+    uint64_t positions = 0;
+    uint64_t errors = 0; // games cut short by a move that didn't resolve or a bad FEN tag
+};
+
+// called from several threads at once. records of one game arrive in
+// order on one thread; games from different shards interleave.
+using PgnCallback = std::function<void(const PgnRecord&)>;
+
+// resolves a SAN move (Nf3, exd5, O-O, e8=Q+) against the legal moves of b.
+// returns false if it names no move or more than one.
+bool parse_san(const Board& b, std::string_view san, Move& move);
+
+const char* result_string(GameResult result);
+
+// memory maps the file, splits it at game boundaries into one shard per
+// thread and replays every game, calling on_record for each move.
+// returns false if the file can't be opened.
+bool read_pgn(const std::string& path, int threads, const PgnCallback& on_record, PgnStats& stats);
+
+#endif
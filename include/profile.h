@@ -0,0 +1,81 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <ostream>
+
+// scoped probes around the hot board functions. they only exist in the
+// `make profile` build (CHESS_PROFILE); otherwise PROFILE_SCOPE expands to
+// nothing and costs nothing.
+
+enum ProfileProbe {
+    PROBE_GENERATE_PSEUDO_MOVES,
+    PROBE_GENERATE_MOVES,
+    PROBE_LEGALITY_FILTER,
+    PROBE_IS_SQUARE_ATTACKED,
+    PROBE_MAKE_MOVE,
+    PROBE_UNMAKE_MOVE,
+    PROBE_EVALUATE,
+    PROBE_COUNT
+};
+
+#ifdef CHESS_PROFILE
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+inline uint64_t profile_ticks() { return __rdtsc(); }
+#else
+#include <chrono>
+inline uint64_t profile_ticks() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+#endif
+
+// hardware counters for the scope, all zero unless CHESS_PROFILE_PERF=1
+// and perf_event_open is allowed
+struct PerfCounts {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+};
+
+bool profile_perf_enabled();
+PerfCounts profile_read_perf();
+void profile_record(ProfileProbe probe, uint64_t ticks, const PerfCounts& start);
+
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileProbe probe) : probe_(probe) {
+        if (profile_perf_enabled()) perf_start_ = profile_read_perf();
+        start_ = profile_ticks();
+    }
+
+    ~ProfileScope() {
+        profile_record(probe_, profile_ticks() - start_, perf_start_);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileProbe probe_;
+    uint64_t start_ = 0;
+    PerfCounts perf_start_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(probe) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(probe)
+
+#else
+
+#define PROFILE_SCOPE(probe) ((void)0)
+
+#endif
+
+// summary table of every probe over all threads, as `info string` lines
+void profile_report(std::ostream& out);
+void profile_reset();
+
+#endif
@@ -1,6 +1,17 @@
 #ifndef PST_TABLES_H
 #define PST_TABLES_H
 
+// evaluation parameters. `chess_engine tune` writes a regenerated copy of
+// this file with tuned values.
+
+// centipawns by Piece. the king's value cancels out of evaluate and only
+// matters to SEE.
+const int piece_values[13] = {
+    100, 500, 320, 330, 900, 20000,
+    100, 500, 320, 330, 900, 20000,
+    0
+};
+
 const int pawn_table[64] = {
      0,  0,  0,  0,  0,  0,  0,  0,
      5, 10, 10,-20,-20, 10, 10,  5,
@@ -0,0 +1,19 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cstddef>
+#include <string>
+
+struct ServerOptions {
+    std::string socket_path = "/tmp/chess_engine.sock";
+    int threads = 0;                // 0 means one per hardware thread
+    size_t session_hash_mb = 1;     // hash for a new session
+    size_t max_session_hash_mb = 16; // cap for setoption name Hash
+};
+
+// accepts sessions on a unix socket until SIGINT/SIGTERM. each session is
+// its own Engine speaking UCI, and every search runs on one shared pool.
+// returns the process exit code.
+int run_server(const ServerOptions& options);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef TESTSUITE_H
+#define TESTSUITE_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "engine.h"
+
+// one EPD record. best holds the bm moves, avoid the am moves; a position
+// has at least one of the two.
+struct EpdEntry {
+    std::string id;
+    Board board;
+    std::vector<Move> best;
+    std::vector<Move> avoid;
+    std::string expected; // the bm/am operations as written, for the report
+};
+
+// parses `<placement> <side> <castling> <ep> op args; op args; ...`.
+// false with error set if the line isn't usable (bad position, no bm/am,
+// unknown move).
+bool parse_epd(const std::string& line, EpdEntry& entry, std::string& error);
+
+struct TestsuiteOptions {
+    std::string path;
+    int threads = 0; // 0 means one per hardware thread
+    size_t hash_mb = 16;
+    SearchLimits limits;
+};
+
+// searches every position on a thread pool, one Engine per position, and
+// prints a line per position plus solve counts and the time and node
+// distribution to the first iteration from which the answer stayed right.
+// returns the process exit code.
+int run_testsuite(const TestsuiteOptions& options, std::ostream& out);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed-size pool where every worker has its own job queue. workers take
+// their own oldest job first and steal the oldest job from a neighbour
+// when they run dry, so jobs are served roughly in submission order.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // from a worker the job goes on that worker's queue, otherwise round-robin
+    void submit(std::function<void()> job);
+
+    int size() const { return static_cast<int>(workers_.size()); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    void worker_loop(int index);
+    bool pop(int index, std::function<void()>& job);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<int> pending_{0};
+    std::atomic<unsigned> next_{0};
+    bool stopping_ = false;
+};
+
+#endif
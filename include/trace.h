@@ -0,0 +1,123 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+
+// search tree trace. every node the search leaves is written as one
+// TraceNode, children before their parent, so the file can be turned back
+// into the tree offline (tools/trace_tree.py). a search thread only writes
+// into its own ring; one writer thread drains all rings to the file.
+
+enum TraceReason : uint8_t {
+    TRACE_EXACT,     // score inside the window
+    TRACE_FAIL_LOW,  // no move reached alpha (white) / beta (black)
+    TRACE_CUTOFF,    // a move closed the window, rest skipped
+    TRACE_HASH,      // transposition table cutoff
+    TRACE_MATE,
+    TRACE_STALEMATE,
+    TRACE_STAND_PAT, // quiescence stopped on the static eval
+    TRACE_QUIESCE,   // quiescence node that searched captures
+    TRACE_STOPPED,   // search was stopped, score is meaningless
+    TRACE_ROOT,      // one finished root iteration
+};
+
+// score and window are white-relative like the search itself. from/to is
+// the move that led to the node, -1 at the root.
+struct TraceNode {
+    int32_t alpha;
+    int32_t beta;
+    int32_t score;
+    uint8_t ply;
+    int8_t from;
+    int8_t to;
+    uint8_t reason;
+};
+
+static_assert(sizeof(TraceNode) == 16, "trace records are 16 bytes on disk");
+
+// file: the magic, then chunks of {uint32 thread, uint32 count, TraceNode[count]}
+constexpr char kTraceMagic[8] = {'C', 'E', 'T', 'R', 'C', '0', '1', '\n'};
+
+// single producer / single consumer ring owned by one search thread
+class SearchTrace {
+public:
+    static constexpr size_t kCapacity = 1 << 16;
+    static constexpr int kMaxPly = 128;
+
+    explicit SearchTrace(uint32_t id) : id_(id), ring_(kCapacity) {}
+
+    // around every child the search descends into
+    void push(Move move) {
+        if (ply_ < kMaxPly) path_[ply_] = move;
+        ply_++;
+    }
+    void pop() { ply_--; }
+
+    void record(int alpha, int beta, int score, TraceReason reason) {
+        Move move = (ply_ > 0 && ply_ <= kMaxPly) ? path_[ply_ - 1] : Move{-1, -1};
+        TraceNode node{alpha, beta, score, static_cast<uint8_t>(std::min(ply_, 255)),
+                       static_cast<int8_t>(move.from), static_cast<int8_t>(move.to),
+                       static_cast<uint8_t>(reason)};
+
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        // full: wait for the writer rather than lose a node and break the tree
+        while (head - tail_cache_ >= kCapacity) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ >= kCapacity) std::this_thread::yield();
+        }
+
+        ring_[head & (kCapacity - 1)] = node;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+private:
+    friend class TraceWriter;
+
+    uint32_t id_;
+    std::vector<TraceNode> ring_;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+    uint64_t tail_cache_ = 0; // producer's last look at tail_
+
+    int ply_ = 0;
+    Move path_[kMaxPly];
+};
+
+class TraceWriter {
+public:
+    TraceWriter() = default;
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool open(const std::string& path);
+    // drains every ring and closes the file
+    void close();
+    bool is_open() const { return file_ != nullptr; }
+
+    // a ring for one more search thread, owned by the writer
+    SearchTrace* add_thread();
+
+private:
+    void run();
+    bool drain();
+
+    std::FILE* file_ = nullptr;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<SearchTrace>> traces_;
+    std::atomic<bool> done_{false};
+    std::thread thread_;
+};
+
+#endif
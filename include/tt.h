@@ -0,0 +1,64 @@
+#ifndef TT_H
+#define TT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+enum TTBound : uint8_t {
+    TT_EXACT,
+    TT_LOWER, // score is at least this
+    TT_UPPER  // score is at most this
+};
+
+struct TTEntry {
+    uint64_t key;
+    int32_t score; // white's point of view, same as search()
+    int16_t depth;
+    uint8_t bound;
+    uint8_t used;
+    int8_t from;
+    int8_t to;
+};
+
+// always-replace table indexed by the low bits of the position key.
+// each Engine owns one, so separate engines never share entries.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t mb = 16);
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    void resize(size_t mb);
+    void clear();
+
+    bool probe(uint64_t key, TTEntry& out) const;
+    void store(uint64_t key, int depth, int score, TTBound bound, Move best);
+
+    size_t size_mb() const { return mb_; }
+
+    // snapshot on disk. key_scheme identifies how position keys are made and
+    // eval_scheme the evaluation the scores came from; load refuses files
+    // from another version, entry layout, key scheme or evaluation.
+    // on posix the file is mapped copy-on-write, so loading is immediate and
+    // pages come in as the search touches them. error says why on failure.
+    bool save(const std::string& path, uint64_t key_scheme, uint64_t eval_scheme, std::string& error) const;
+    bool load(const std::string& path, uint64_t key_scheme, uint64_t eval_scheme, std::string& error);
+
+private:
+    void release();
+
+    std::vector<TTEntry> owned_;
+    TTEntry* entries_ = nullptr; // owned_ or the mapped file
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    size_t mask_ = 0;
+    size_t mb_ = 0;
+};
+
+#endif
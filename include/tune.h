@@ -0,0 +1,61 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+// evaluate() as a linear function: evaluate(b) is the sum of weight * count
+// over these features. counts are white's minus black's, black pieces read
+// the tables from the mirrored square like evaluate does. the king's value
+// cancels, so it isn't a parameter.
+constexpr int kTuneMaterial = 0;                         // pawn, rook, knight, bishop, queen, in Piece order
+constexpr int kTunePawnTable = kTuneMaterial + 5;        // pawn_table[64]
+constexpr int kTuneKnightTable = kTunePawnTable + 64;    // knight_table[64]
+constexpr int kTuneParams = kTuneKnightTable + 64;
+
+using TuneParams = std::array<double, kTuneParams>;
+
+// labelled positions as parallel arrays. position i's nonzero feature
+// counts are feature/count[begin[i] .. begin[i + 1]).
+struct TuneSet {
+    std::vector<float> result; // 1 white won, 0.5 draw, 0 black won
+    std::vector<uint32_t> begin = {0};
+    std::vector<uint8_t> feature;
+    std::vector<int8_t> count;
+
+    size_t size() const { return result.size(); }
+};
+
+// the parameters the engine is built with
+TuneParams current_params();
+
+void add_position(TuneSet& set, const Board& board, float result);
+
+// loads `fen<TAB>...<TAB>result` lines (the `pgn` text output) on `threads`
+// threads. lines that don't parse are skipped, and so are positions in check
+// or with a capture that wins material by SEE, the static eval of those says
+// little about the result.
+// false with error set if the file can't be read.
+bool load_tune_set(const std::string& path, int threads, TuneSet& set, uint64_t& skipped, std::string& error);
+
+struct TuneOptions {
+    std::string path;
+    std::string out_path = "pst_tables.tuned.h";
+    int threads = 0;       // 0 means one per hardware thread
+    int iterations = 1000; // full passes over the data
+    double rate = 1.0;     // step size in centipawns
+};
+
+// fits the sigmoid scale to the current parameters, then minimises the
+// mean squared error between result and sigmoid(eval) with Adam, and writes
+// the tuned parameters as a replacement for include/pst_tables.h.
+// returns the process exit code.
+int run_tune(const TuneOptions& options, std::ostream& log);
+
+#endif
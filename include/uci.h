@@ -0,0 +1,19 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+
+// deepest fixed-depth search `go depth` and `analyze --depth` will run
+constexpr int kMaxSearchDepth = 4;
+
+std::vector<std::string> split_tokens(const std::string& line);
+
+// runs one UCI command against engine, writing replies to out.
+// returns false once the command was quit.
+bool handle_uci_command(Engine& engine, const std::vector<std::string>& tokens, std::ostream& out);
+
+#endif
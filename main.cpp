@@ -1,102 +1,29 @@
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "include/board.h"
+#include "include/engine.h"
+#include "include/packed.h"
+#include "include/pgn.h"
+#include "include/server.h"
+#include "include/testsuite.h"
+#include "include/tune.h"
+#include "include/uci.h"
 
-static std::vector<std::string> split_tokens(const std::string& line) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(line);
-    std::string tok;
-    while (iss >> tok) tokens.push_back(tok);
-    return tokens;
-}
-
-static void apply_moves(Board& board, const std::vector<std::string>& tokens, size_t start) {
-    for (size_t i = start; i < tokens.size(); i++) {
-        if (tokens[i].size() < 4) continue;
-        Move move = parse_move(tokens[i]);
-        make_move(board, move);
-    }
-}
-
-static void run_uci_loop(Board& board) {
-    constexpr int kDefaultDepth = 3;
-    constexpr int kMaxSearchDepth = 4;
-
+static void run_uci_loop(Engine& engine) {
     std::string line;
     while (std::getline(std::cin, line)) {
         if (line.empty()) continue;
 
-        auto tokens = split_tokens(line);
-        if (tokens.empty()) continue;
-
-        const std::string& cmd = tokens[0];
-
-        if (cmd == "uci") {
-
-            std::cout << "id name simple_engine" << std::endl;
-            std::cout << "id author el-tahir" << std::endl;
-            std::cout << "option name Hash type spin default 16 min 1 max 1024" << std::endl;
-            std::cout << "uciok" << std::endl;
-
-        } else if (cmd == "isready") {
-
-            std::cout << "readyok" << std::endl;
-        } else if (cmd == "ucinewgame") {
-            init_board(board);
-
-
-        } else if (cmd == "position") {
-
-            if (tokens.size() >= 2 && tokens[1] == "startpos") {
-                init_board(board);
-                size_t move_idx = 2;
-                if (move_idx < tokens.size() && tokens[move_idx] == "moves") {
-                    apply_moves(board, tokens, move_idx + 1);
-                }
-            } else if (tokens.size() >= 8 && tokens[1] == "fen") {
-                std::string fen;
-                for (size_t i = 2; i < 8; i++) {
-                    if (i > 2) fen += " ";
-                    fen += tokens[i];
-                }
-                load_fen(board, fen);
-                size_t move_idx = 8;
-                if (move_idx < tokens.size() && tokens[move_idx] == "moves") {
-                    apply_moves(board, tokens, move_idx + 1);
-                }
-            }
-        } else if (cmd == "setoption") {
-            // option values are currently ignored, but command support keeps UCI clients happy.
-            continue;
-        } else if (cmd == "go") {
-            int depth = kDefaultDepth;
-            for (size_t i = 1; i + 1 < tokens.size(); i++) {
-                if (tokens[i] == "depth") {
-                    try {
-                        depth = std::stoi(tokens[i + 1]);
-                    } catch (...) {
-                        depth = kDefaultDepth;
-                    }
-                    break;
-                }
-            }
-            depth = std::clamp(depth, 1, kMaxSearchDepth);
-
-            auto moves = generate_moves(board);
-            if (moves.empty()) {
-                std::cout << "bestmove 0000" << std::endl;
-            } else {
-                Move best = get_best_move(board, depth);
-                std::cout << "bestmove " << index_to_square(best.from)
-                          << index_to_square(best.to) << std::endl;
-            }
-        } else if (cmd == "quit") {
-            break;
-        }
+        if (!handle_uci_command(engine, split_tokens(line), std::cout)) break;
     }
 }
 
@@ -171,16 +98,280 @@ static void run_cli_loop(Board& board) {
     }
 }
 
-int main(int argc, char** argv) {
-    Board board;
-    init_board(board);
+// pgn <file> [--threads N] [--out file|-] [--format text|packed]
+// text writes one "fen<TAB>move<TAB>result" line per replayed move,
+// packed writes each distinct position once as a PackedPosition
+static int run_pgn(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: chess_engine pgn <file> [--threads N] [--out file|-] [--format text|packed]" << std::endl;
+        return 1;
+    }
+
+    std::string path = argv[2];
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    std::string out_path;
+    bool packed = false;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--threads") threads = std::max(1, std::atoi(argv[i + 1]));
+        else if (flag == "--out") out_path = argv[i + 1];
+        else if (flag == "--format") packed = (std::string(argv[i + 1]) == "packed");
+        else std::cerr << "unknown option " << flag << std::endl;
+    }
+    threads = std::max(1, threads);
+
+    std::ofstream file;
+    std::ostream* out = nullptr;
+    if (out_path == "-") {
+        out = &std::cout;
+    } else if (!out_path.empty()) {
+        file.open(out_path, std::ios::binary);
+        if (!file) {
+            std::cerr << "cannot write " << out_path << std::endl;
+            return 1;
+        }
+        out = &file;
+    }
+    if (out && packed) out->write(kPackedMagic, sizeof(kPackedMagic));
+
+    // each worker fills its own buffer and only locks to hand it over
+    constexpr size_t kFlushBytes = 1 << 20;
+    std::vector<std::string> buffers(threads);
+    std::mutex out_mutex;
+    PositionSet seen;
+    uint64_t duplicates = 0;
+
+    auto flush = [&](std::string& buf) {
+        std::lock_guard<std::mutex> lock(out_mutex);
+        if (!packed) {
+            out->write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        } else {
+            for (size_t i = 0; i + sizeof(PackedPosition) <= buf.size(); i += sizeof(PackedPosition)) {
+                PackedPosition p;
+                std::memcpy(&p, buf.data() + i, sizeof(p));
+                if (seen.insert(p)) out->write(reinterpret_cast<const char*>(&p), sizeof(p));
+                else duplicates++;
+            }
+        }
+        buf.clear();
+    };
+
+    auto on_record = [&](const PgnRecord& r) {
+        if (!out) return;
+
+        std::string& buf = buffers[r.thread];
+        if (packed) {
+            PackedPosition p = pack_position(*r.board);
+            buf.append(reinterpret_cast<const char*>(&p), sizeof(p));
+        } else {
+            buf += to_fen(*r.board);
+            buf += '\t';
+            buf += index_to_square(r.move.from);
+            buf += index_to_square(r.move.to);
+            buf += '\t';
+            buf += result_string(r.result);
+            buf += '\n';
+        }
+        if (buf.size() >= kFlushBytes) flush(buf);
+    };
+
+    PgnStats stats;
+    auto start = std::chrono::steady_clock::now();
+
+    if (!read_pgn(path, threads, on_record, stats)) {
+        std::cerr << "cannot read " << path << std::endl;
+        return 1;
+    }
+    if (out) {
+        for (auto& buf : buffers) flush(buf);
+        out->flush();
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "games " << stats.games << " positions " << stats.positions
+              << " errors " << stats.errors << " seconds " << secs
+              << " games/min " << static_cast<uint64_t>(secs > 0 ? stats.games * 60 / secs : 0);
+    if (packed) std::cerr << " unique " << seen.size() << " duplicates " << duplicates;
+    std::cerr << std::endl;
+    return 0;
+}
+
+// analyze <file> [--depth N] [--dedup]
+// the file is either FEN lines (anything after a tab is ignored, so pgn
+// text output works) or a packed position file. prints fen, best move and
+// score from the side to move for each position; ones that aren't legal
+// positions are counted as skipped.
+static int run_analyze(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: chess_engine analyze <file> [--depth N] [--dedup 0|1]" << std::endl;
+        return 1;
+    }
+
+    int depth = 3;
+    bool dedup = false;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--depth") depth = std::clamp(std::atoi(argv[i + 1]), 1, kMaxSearchDepth);
+        else if (flag == "--dedup") dedup = std::atoi(argv[i + 1]) != 0;
+        else std::cerr << "unknown option " << flag << std::endl;
+    }
+
+    std::ifstream in(argv[2], std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot read " << argv[2] << std::endl;
+        return 1;
+    }
+
+    char magic[sizeof(kPackedMagic)] = {};
+    in.read(magic, sizeof(magic));
+    const bool binary = in.gcount() == sizeof(magic) && std::memcmp(magic, kPackedMagic, sizeof(magic)) == 0;
+    if (!binary) {
+        in.clear();
+        in.seekg(0);
+    }
+
+    Engine engine;
+    PositionSet seen;
+    uint64_t analyzed = 0, skipped = 0, invalid = 0;
+
+    auto analyze = [&](const Board& b) {
+        if (dedup && !seen.insert(pack_position(b))) {
+            skipped++;
+            return;
+        }
+
+        engine.set_position(b);
+        SearchResult result = engine.search(depth);
+        analyzed++;
+
+        std::cout << to_fen(b) << '\t';
+        if (result.lines.empty()) {
+            std::cout << "0000\t0\n";
+            return;
+        }
+        const RootLine& best = result.lines[0];
+        int cp = is_white_turn(b) ? best.score : -best.score;
+        std::cout << index_to_square(best.move.from) << index_to_square(best.move.to) << '\t' << cp << '\n';
+    };
+
+    if (binary) {
+        PackedPosition p;
+        while (in.read(reinterpret_cast<char*>(&p), sizeof(p))) {
+            Board b;
+            if (unpack_position(p, b)) analyze(b);
+            else invalid++;
+        }
+    } else {
+        std::string line;
+        while (std::getline(in, line)) {
+            line = line.substr(0, line.find('\t'));
+            if (line.empty()) continue;
+
+            if (!is_valid_fen(line)) {
+                invalid++;
+                continue;
+            }
+
+            Board b;
+            load_fen(b, line);
+            analyze(b);
+        }
+    }
+
+    std::cout.flush();
+    std::cerr << "analyzed " << analyzed << " duplicates " << skipped << " skipped " << invalid << std::endl;
+    return 0;
+}
 
+int main(int argc, char** argv) {
     if (argc > 1 && std::string(argv[1]) == "cli") {
+        Board board;
         run_cli_loop(board);
         return 0;
     }
 
-    run_uci_loop(board);
+    if (argc > 1 && std::string(argv[1]) == "pgn") {
+        return run_pgn(argc, argv);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "analyze") {
+        return run_analyze(argc, argv);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "testsuite") {
+        if (argc < 3) {
+            std::cerr << "usage: chess_engine testsuite <file.epd> [--threads N] [--time ms] [--nodes N] [--depth N] [--hash MB]" << std::endl;
+            return 1;
+        }
+
+        TestsuiteOptions options;
+        options.path = argv[2];
+        options.limits.movetime_ms = 1000;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string flag = argv[i];
+            std::string value = argv[i + 1];
+            try {
+                if (flag == "--threads") options.threads = std::stoi(value);
+                else if (flag == "--time") options.limits.movetime_ms = std::stoll(value);
+                else if (flag == "--nodes") options.limits.nodes = std::stoull(value);
+                else if (flag == "--depth") options.limits.depth = std::clamp(std::stoi(value), 1, 64);
+                else if (flag == "--hash") options.hash_mb = std::stoul(value);
+                else std::cerr << "unknown option " << flag << std::endl;
+            } catch (...) {
+                std::cerr << "bad value for " << flag << std::endl;
+                return 1;
+            }
+        }
+        return run_testsuite(options, std::cout);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "tune") {
+        if (argc < 3) {
+            std::cerr << "usage: chess_engine tune <records.tsv> [--threads N] [--iterations N] [--rate cp] [--out file]" << std::endl;
+            return 1;
+        }
+
+        TuneOptions options;
+        options.path = argv[2];
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string flag = argv[i];
+            std::string value = argv[i + 1];
+            try {
+                if (flag == "--threads") options.threads = std::stoi(value);
+                else if (flag == "--iterations") options.iterations = std::max(0, std::stoi(value));
+                else if (flag == "--rate") options.rate = std::stod(value);
+                else if (flag == "--out") options.out_path = value;
+                else std::cerr << "unknown option " << flag << std::endl;
+            } catch (...) {
+                std::cerr << "bad value for " << flag << std::endl;
+                return 1;
+            }
+        }
+        return run_tune(options, std::cerr);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "serve") {
+        ServerOptions options;
+        for (int i = 2; i + 1 < argc; i += 2) {
+            std::string flag = argv[i];
+            std::string value = argv[i + 1];
+            try {
+                if (flag == "--socket") options.socket_path = value;
+                else if (flag == "--threads") options.threads = std::stoi(value);
+                else if (flag == "--hash") options.session_hash_mb = std::stoul(value);
+                else if (flag == "--max-hash") options.max_session_hash_mb = std::stoul(value);
+                else std::cerr << "unknown option " << flag << std::endl;
+            } catch (...) {
+                std::cerr << "bad value for " << flag << std::endl;
+                return 1;
+            }
+        }
+        return run_server(options);
+    }
+
+    Engine engine;
+    run_uci_loop(engine);
 
     return 0;
 }
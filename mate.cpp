@@ -0,0 +1,304 @@
+#include <cstdlib>
+#include <unordered_map>
+
+#include "include/mate.h"
+
+static const int knight_offsets[] = {-17, -15, -10, -6, 6, 10, 15, 17};
+static const int bishop_offsets[] = {-9, -7, 7, 9};
+static const int rook_offsets[] = {-8, 8, -1, 1};
+
+static Color color_of(Piece p) {
+    return (p <= W_KING) ? WHITE : BLACK;
+}
+
+// next square along offset from square, or -1 off the board
+static int step(int square, int offset) {
+    int target = square + offset;
+
+    if (target < 0 || target >= 64) return -1;
+
+    int target_file = target % 8;
+    if ((offset == -1 || offset == -9 || offset == 7) && target_file == 7) return -1; // wrap left
+    if ((offset == 1 || offset == 9 || offset == -7) && target_file == 0) return -1; // wrap right
+    if (std::abs(square % 8 - target_file) > 2) return -1; // knight wrap
+
+    return target;
+}
+
+static bool is_diagonal(int offset) {
+    return offset == -9 || offset == -7 || offset == 7 || offset == 9;
+}
+
+// true if p is a slider of color c that moves along offset
+static bool slides_along(Piece p, Color c, int offset) {
+    if (p == EMPTY || color_of(p) != c) return false;
+    if (p == W_QUEEN || p == B_QUEEN) return true;
+    if (is_diagonal(offset)) return p == W_BISHOP || p == B_BISHOP;
+    return p == W_ROOK || p == B_ROOK;
+}
+
+// make the move and keep it only if it's legal and, when want_check is set,
+// leaves the opponent in check
+static void keep_if_legal(const Board& b, Move move, bool want_check, std::vector<Move>& out) {
+    Board temp = b;
+    make_move(temp, move);
+
+    if (is_square_attacked(temp, find_king(temp, b.side_to_move), temp.side_to_move)) return;
+    if (want_check && !is_square_attacked(temp, find_king(temp, temp.side_to_move), b.side_to_move)) return;
+
+    out.push_back(move);
+}
+
+std::vector<Move> generate_checks(const Board& b) {
+    const Color us = b.side_to_move;
+    const Color them = (us == WHITE) ? BLACK : WHITE;
+    const int ksq = find_king(b, them);
+
+    std::vector<Move> checks;
+    if (ksq < 0) return checks;
+
+    // direct-check masks: squares a piece of ours would check from
+    bool pawn_mask[64] = {};
+    bool knight_mask[64] = {};
+    bool diagonal_mask[64] = {};
+    bool line_mask[64] = {};
+    // our pieces standing between one of our sliders and their king
+    bool blocker[64] = {};
+
+    int file = ksq % 8;
+    if (us == WHITE) {
+        if (file != 0 && ksq - 9 >= 0) pawn_mask[ksq - 9] = true;
+        if (file != 7 && ksq - 7 >= 0) pawn_mask[ksq - 7] = true;
+    } else {
+        if (file != 0 && ksq + 7 < 64) pawn_mask[ksq + 7] = true;
+        if (file != 7 && ksq + 9 < 64) pawn_mask[ksq + 9] = true;
+    }
+
+    for (int offset : knight_offsets) {
+        int target = step(ksq, offset);
+        if (target >= 0) knight_mask[target] = true;
+    }
+
+    for (int dir = 0; dir < 8; dir++) {
+        int offset = (dir < 4) ? bishop_offsets[dir] : rook_offsets[dir - 4];
+        bool* mask = (dir < 4) ? diagonal_mask : line_mask;
+
+        int sq = step(ksq, offset);
+        while (sq >= 0 && b.board[sq] == EMPTY) {
+            mask[sq] = true;
+            sq = step(sq, offset);
+        }
+        if (sq < 0) continue;
+
+        mask[sq] = true; // capturing the first piece on the ray also checks
+
+        if (color_of(b.board[sq]) != us) continue;
+
+        int behind = step(sq, offset);
+        while (behind >= 0 && b.board[behind] == EMPTY) behind = step(behind, offset);
+        if (behind >= 0 && slides_along(b.board[behind], us, offset)) blocker[sq] = true;
+    }
+
+    std::vector<Move> moves;
+
+    for (int sq = 0; sq < 64; sq++) {
+        Piece p = b.board[sq];
+        if (p == EMPTY || color_of(p) != us) continue;
+
+        moves.clear();
+        generate_square_moves(b, sq, moves);
+
+        for (Move move : moves) {
+            bool candidate = blocker[sq];
+
+            switch (p) {
+                case W_PAWN:
+                case B_PAWN: {
+                    // the new queen can check through the square the pawn just left,
+                    // which the masks treat as blocked, so promotions are always tried
+                    bool promotes = (move.to / 8 == 7 || move.to / 8 == 0);
+                    candidate |= promotes || pawn_mask[move.to];
+                    candidate |= (move.to == b.en_passant_square); // may uncover a check
+                    break;
+                }
+                case W_KNIGHT: case B_KNIGHT: candidate |= knight_mask[move.to]; break;
+                case W_BISHOP: case B_BISHOP: candidate |= diagonal_mask[move.to]; break;
+                case W_ROOK: case B_ROOK: candidate |= line_mask[move.to]; break;
+                case W_QUEEN: case B_QUEEN: candidate |= diagonal_mask[move.to] || line_mask[move.to]; break;
+                case W_KING: case B_KING: candidate |= std::abs(move.to - move.from) == 2; break; // castling rook
+                default: break;
+            }
+
+            if (candidate) keep_if_legal(b, move, true, checks);
+        }
+    }
+
+    return checks;
+}
+
+std::vector<Move> generate_evasions(const Board& b) {
+    const Color us = b.side_to_move;
+    const Color them = (us == WHITE) ? BLACK : WHITE;
+    const int ksq = find_king(b, us);
+
+    std::vector<Move> evasions;
+    if (ksq < 0) return evasions;
+
+    // find the checkers
+    int checkers = 0;
+    int checker_sq = -1;
+    bool target[64] = {};
+
+    int file = ksq % 8;
+    Piece pawn = (them == WHITE) ? W_PAWN : B_PAWN;
+    int pawn_sqs[2] = {-1, -1};
+    if (them == WHITE) {
+        if (file != 0 && ksq - 9 >= 0) pawn_sqs[0] = ksq - 9;
+        if (file != 7 && ksq - 7 >= 0) pawn_sqs[1] = ksq - 7;
+    } else {
+        if (file != 0 && ksq + 7 < 64) pawn_sqs[0] = ksq + 7;
+        if (file != 7 && ksq + 9 < 64) pawn_sqs[1] = ksq + 9;
+    }
+    for (int sq : pawn_sqs) {
+        if (sq >= 0 && b.board[sq] == pawn) { checkers++; checker_sq = sq; }
+    }
+
+    Piece knight = (them == WHITE) ? W_KNIGHT : B_KNIGHT;
+    for (int offset : knight_offsets) {
+        int sq = step(ksq, offset);
+        if (sq >= 0 && b.board[sq] == knight) { checkers++; checker_sq = sq; }
+    }
+
+    for (int dir = 0; dir < 8; dir++) {
+        int offset = (dir < 4) ? bishop_offsets[dir] : rook_offsets[dir - 4];
+
+        int sq = step(ksq, offset);
+        while (sq >= 0 && b.board[sq] == EMPTY) sq = step(sq, offset);
+        if (sq < 0 || !slides_along(b.board[sq], them, offset)) continue;
+
+        checkers++;
+        checker_sq = sq;
+        // squares between king and slider can be blocked
+        for (int between = step(ksq, offset); between != sq; between = step(between, offset)) {
+            target[between] = true;
+        }
+    }
+
+    if (checkers == 1) target[checker_sq] = true;
+    else if (checkers == 0) return generate_moves(b); // not in check, everything goes
+
+    std::vector<Move> moves;
+
+    for (int sq = 0; sq < 64; sq++) {
+        Piece p = b.board[sq];
+        if (p == EMPTY || color_of(p) != us) continue;
+
+        moves.clear();
+        generate_square_moves(b, sq, moves);
+
+        const bool king = (sq == ksq);
+        for (Move move : moves) {
+            bool candidate = king;
+            if (!king && checkers == 1) {
+                candidate = target[move.to];
+                // en passant can take a checking pawn
+                if ((p == W_PAWN || p == B_PAWN) && move.to == b.en_passant_square) {
+                    candidate |= (move.to + (us == WHITE ? -8 : 8)) == checker_sq;
+                }
+            }
+            if (candidate) keep_if_legal(b, move, false, evasions);
+        }
+    }
+
+    return evasions;
+}
+
+struct MateEntry {
+    int mate_in = 0;      // proven mate in this many moves, 0 if none yet
+    int no_mate_upto = 0; // proven there's no mate in this many moves or fewer
+};
+
+struct MateSearch {
+    std::unordered_map<uint64_t, MateEntry> table;
+    const std::atomic<bool>* stop = nullptr;
+    uint64_t nodes = 0;
+
+    bool stopped() const { return stop && stop->load(std::memory_order_relaxed); }
+
+    bool attacker_mates(Board& b, int n, Move* best);
+    bool defender_loses(Board& b, int n);
+};
+
+// attacker to move: is there a check that mates within n moves?
+bool MateSearch::attacker_mates(Board& b, int n, Move* best) {
+    nodes++;
+
+    const uint64_t key = position_key(b);
+    if (!best) {
+        auto it = table.find(key);
+        if (it != table.end()) {
+            if (it->second.mate_in && it->second.mate_in <= n) return true;
+            if (it->second.no_mate_upto >= n) return false;
+        }
+    }
+
+    for (Move move : generate_checks(b)) {
+        if (stopped()) return false;
+
+        UndoInfo undo = make_move(b, move);
+        bool mates = defender_loses(b, n);
+        unmake_move(b, move, undo);
+
+        if (mates) {
+            MateEntry& e = table[key];
+            if (!e.mate_in || n < e.mate_in) e.mate_in = n;
+            if (best) *best = move;
+            return true;
+        }
+    }
+
+    if (!stopped()) {
+        MateEntry& e = table[key];
+        if (n > e.no_mate_upto) e.no_mate_upto = n;
+    }
+    return false;
+}
+
+// defender to move and in check, attacker has n moves left counting the one just played
+bool MateSearch::defender_loses(Board& b, int n) {
+    nodes++;
+
+    std::vector<Move> evasions = generate_evasions(b);
+    if (evasions.empty()) return true; // only checks are played, so this is mate
+    if (n <= 1) return false;
+
+    for (Move move : evasions) {
+        UndoInfo undo = make_move(b, move);
+        bool mated = attacker_mates(b, n - 1, nullptr);
+        unmake_move(b, move, undo);
+
+        if (!mated) return false;
+    }
+
+    return true;
+}
+
+MateResult mate_search(Board& b, int max_moves, const std::atomic<bool>* stop) {
+    MateSearch ms;
+    ms.stop = stop;
+
+    MateResult result;
+
+    // shortest mate first. the table carries over between iterations.
+    for (int n = 1; n <= max_moves && !ms.stopped(); n++) {
+        Move best = {0, 0};
+        if (ms.attacker_mates(b, n, &best)) {
+            result.move = best;
+            result.mate_in = n;
+            break;
+        }
+    }
+
+    result.nodes = ms.nodes;
+    return result;
+}
@@ -0,0 +1,243 @@
+// per-call timings of the board primitives over a fixed set of positions.
+// prints JSON (to stdout or --out) that tools/compare_bench.py can diff.
+//
+//   ./microbench [--reps N] [--min-ms N] [--filter name] [--out file]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "include/board.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const char* corpus_fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1",
+    "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",
+};
+
+static volatile uint64_t sink;
+
+struct Corpus {
+    std::vector<std::string> fens;
+    std::vector<Board> boards;
+    std::vector<std::vector<Move>> legal; // legal moves of each board
+    std::vector<std::string> move_strings;
+};
+
+static Corpus build_corpus() {
+    Corpus c;
+    for (const char* fen : corpus_fens) {
+        Board b;
+        load_fen(b, fen);
+        c.fens.push_back(fen);
+        c.boards.push_back(b);
+        c.legal.push_back(generate_moves(b));
+        for (Move m : c.legal.back()) {
+            c.move_strings.push_back(index_to_square(m.from) + index_to_square(m.to));
+        }
+    }
+    return c;
+}
+
+struct Bench {
+    std::string name;
+    // one pass over the corpus, returns the number of calls it made
+    std::function<uint64_t(Corpus&)> pass;
+};
+
+static std::vector<Bench> make_benches() {
+    return {
+        {"make_unmake", [](Corpus& c) {
+            uint64_t ops = 0;
+            for (size_t i = 0; i < c.boards.size(); i++) {
+                Board& b = c.boards[i];
+                for (Move m : c.legal[i]) {
+                    UndoInfo undo = make_move(b, m);
+                    sink = sink + b.board[m.to];
+                    unmake_move(b, m, undo);
+                    ops++;
+                }
+            }
+            return ops;
+        }},
+        {"generate_pseudo_moves", [](Corpus& c) {
+            uint64_t ops = 0;
+            for (const Board& b : c.boards) {
+                sink = sink + generate_pseudo_moves(b).size();
+                ops++;
+            }
+            return ops;
+        }},
+        {"generate_moves", [](Corpus& c) {
+            uint64_t ops = 0;
+            for (const Board& b : c.boards) {
+                sink = sink + generate_moves(b).size();
+                ops++;
+            }
+            return ops;
+        }},
+        {"is_square_attacked", [](Corpus& c) {
+            uint64_t ops = 0;
+            for (const Board& b : c.boards) {
+                uint64_t hits = 0;
+                for (int sq = 0; sq < 64; sq++) {
+                    hits += is_square_attacked(b, sq, WHITE);
+                    hits += is_square_attacked(b, sq, BLACK);
+                }
+                sink = sink + hits;
+                ops += 128;
+            }
+            return ops;
+        }},
+        // the same question answered without the attack maps, so the two
+        // builds (make microbench / make attackmaps) can be compared
+        {"scan_square_attacked", [](Corpus& c) {
+            uint64_t ops = 0;
+            for (const Board& b : c.boards) {
+                uint64_t hits = 0;
+                for (int sq = 0; sq < 64; sq++) {
+                    hits += scan_square_attacked(b, sq, WHITE);
+                    hits += scan_square_attacked(b, sq, BLACK);
+                }
+                sink = sink + hits;
+                ops += 128;
+            }
+            return ops;
+        }},
+        {"evaluate", [](Corpus& c) {
+            uint64_t ops = 0;
+            for (const Board& b : c.boards) {
+                sink = sink + static_cast<uint64_t>(evaluate(b));
+                ops++;
+            }
+            return ops;
+        }},
+        {"load_fen", [](Corpus& c) {
+            uint64_t ops = 0;
+            Board b;
+            for (const std::string& fen : c.fens) {
+                load_fen(b, fen);
+                sink = sink + b.castling_rights;
+                ops++;
+            }
+            return ops;
+        }},
+        {"parse_move", [](Corpus& c) {
+            uint64_t ops = 0;
+            for (const std::string& s : c.move_strings) {
+                Move m = parse_move(s);
+                sink = sink + static_cast<uint64_t>(m.from + m.to);
+                ops++;
+            }
+            return ops;
+        }},
+    };
+}
+
+struct Stats {
+    uint64_t ops_per_rep = 0;
+    double median = 0, p99 = 0, min = 0, mean = 0; // ns per call
+};
+
+static Stats run_bench(const Bench& bench, Corpus& corpus, int reps, double min_ms) {
+    // warm up, then find how many passes make one repetition last min_ms
+    int passes = 1;
+    while (true) {
+        auto start = Clock::now();
+        for (int p = 0; p < passes; p++) bench.pass(corpus);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (ms >= min_ms || passes >= (1 << 24)) break;
+        passes *= 2;
+    }
+
+    std::vector<double> samples;
+    Stats stats;
+
+    for (int r = 0; r < reps; r++) {
+        uint64_t ops = 0;
+        auto start = Clock::now();
+        for (int p = 0; p < passes; p++) ops += bench.pass(corpus);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        samples.push_back(ns / static_cast<double>(ops));
+        stats.ops_per_rep = ops;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) {
+        size_t i = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+        return samples[std::min(i, samples.size() - 1)];
+    };
+
+    stats.median = at(0.5);
+    stats.p99 = at(0.99);
+    stats.min = samples.front();
+    for (double s : samples) stats.mean += s;
+    stats.mean /= samples.size();
+    return stats;
+}
+
+int main(int argc, char** argv) {
+    int reps = 31;
+    double min_ms = 20.0;
+    std::string filter;
+    std::string out_path;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        try {
+            if (flag == "--reps") reps = std::max(1, std::stoi(value));
+            else if (flag == "--min-ms") min_ms = std::stod(value);
+            else if (flag == "--filter") filter = value;
+            else if (flag == "--out") out_path = value;
+            else std::cerr << "unknown option " << flag << std::endl;
+        } catch (...) {
+            std::cerr << "bad value for " << flag << std::endl;
+            return 1;
+        }
+    }
+
+    Corpus corpus = build_corpus();
+
+    std::ostringstream json;
+    json << "{\n  \"reps\": " << reps << ",\n  \"positions\": " << corpus.boards.size()
+         << ",\n  \"benchmarks\": [\n";
+
+    bool first = true;
+    for (const Bench& bench : make_benches()) {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos) continue;
+
+        Stats s = run_bench(bench, corpus, reps, min_ms);
+        std::cerr << bench.name << ": median " << s.median << " ns, p99 " << s.p99 << " ns" << std::endl;
+
+        if (!first) json << ",\n";
+        first = false;
+        json << "    {\"name\": \"" << bench.name << "\", \"ops_per_rep\": " << s.ops_per_rep
+             << ", \"median_ns\": " << s.median << ", \"p99_ns\": " << s.p99
+             << ", \"min_ns\": " << s.min << ", \"mean_ns\": " << s.mean << "}";
+    }
+    json << "\n  ]\n}\n";
+
+    if (out_path.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(out_path);
+        out << json.str();
+    }
+
+    return 0;
+}
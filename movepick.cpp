@@ -0,0 +1,112 @@
+#include <utility>
+
+#include "include/movepick.h"
+
+MovePicker::MovePicker(const Board& b, Move hash_move, const Move* killers)
+    : board_(b), hash_move_(hash_move) {
+    hash_valid_ = is_pseudo_legal(b, hash_move);
+
+    for (int i = 0; i < kKillerSlots; i++) {
+        killers_[i] = killers ? killers[i] : Move{0, 0};
+
+        // a move listed twice would be handed out twice
+        for (int j = 0; j < i; j++) {
+            if (killers_[i] == killers_[j]) killers_[i] = Move{0, 0};
+        }
+    }
+}
+
+bool MovePicker::already_tried(Move move) const {
+    if (move == hash_move_) return true;
+
+    for (Move killer : killers_) {
+        if (move == killer) return true;
+    }
+    return false;
+}
+
+Move MovePicker::select_best(std::vector<ScoredMove>& list) {
+    size_t best = cursor_;
+    for (size_t i = cursor_ + 1; i < list.size(); i++) {
+        if (list[i].score > list[best].score) best = i;
+    }
+
+    std::swap(list[cursor_], list[best]);
+    return list[cursor_++].move;
+}
+
+bool MovePicker::next(Move& move) {
+    while (true) {
+        switch (stage_) {
+        case PICK_HASH:
+            if (cursor_ == 0 && hash_valid_) {
+                cursor_ = 1;
+                move = hash_move_;
+                return true;
+            }
+            break;
+
+        case PICK_GOOD_CAPTURES:
+            if (!generated_) {
+                std::vector<Move> moves;
+                generate_captures(board_, moves);
+
+                // SEE once per capture, which also splits off the losing ones
+                for (Move capture : moves) {
+                    if (capture == hash_move_) continue;
+
+                    int gain = see(board_, capture);
+                    if (gain >= 0) captures_.push_back({capture, gain});
+                    else bad_captures_.push_back({capture, gain});
+                }
+                generated_ = true;
+            }
+            if (cursor_ < captures_.size()) {
+                move = select_best(captures_);
+                return true;
+            }
+            break;
+
+        case PICK_KILLERS:
+            while (cursor_ < kKillerSlots) {
+                Move killer = killers_[cursor_++];
+
+                // a killer comes from a sibling position, so it may not
+                // even be playable here
+                if (killer == hash_move_ || !is_pseudo_legal(board_, killer) || is_capture(board_, killer)) continue;
+
+                move = killer;
+                return true;
+            }
+            break;
+
+        case PICK_QUIETS:
+            if (!generated_) {
+                generate_quiets(board_, quiets_);
+                generated_ = true;
+            }
+            while (cursor_ < quiets_.size()) {
+                Move quiet = quiets_[cursor_++];
+                if (already_tried(quiet)) continue;
+
+                move = quiet;
+                return true;
+            }
+            break;
+
+        case PICK_BAD_CAPTURES:
+            if (cursor_ < bad_captures_.size()) {
+                move = select_best(bad_captures_);
+                return true;
+            }
+            break;
+
+        case PICK_DONE:
+            return false;
+        }
+
+        stage_ = static_cast<PickStage>(stage_ + 1);
+        cursor_ = 0;
+        generated_ = false;
+    }
+}
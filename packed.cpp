@@ -0,0 +1,142 @@
+#include "include/packed.h"
+
+// castling rights that still have their king and rook at home
+static int live_castling_rights(const Board& b) {
+    int rights = b.castling_rights;
+
+    if (b.board[4] != W_KING) rights &= ~(CASTLE_WK | CASTLE_WQ);
+    if (b.board[7] != W_ROOK) rights &= ~CASTLE_WK;
+    if (b.board[0] != W_ROOK) rights &= ~CASTLE_WQ;
+    if (b.board[60] != B_KING) rights &= ~(CASTLE_BK | CASTLE_BQ);
+    if (b.board[63] != B_ROOK) rights &= ~CASTLE_BK;
+    if (b.board[56] != B_ROOK) rights &= ~CASTLE_BQ;
+
+    return rights;
+}
+
+// the en passant square, if a pawn of the side to move could take on it
+static int live_en_passant(const Board& b) {
+    int ep = b.en_passant_square;
+    if (ep < 0) return -1;
+
+    const bool white = (b.side_to_move == WHITE);
+    // only the rank behind a double push, anything else came from a bad FEN
+    if (ep / 8 != (white ? 5 : 2)) return -1;
+
+    const Piece pawn = white ? W_PAWN : B_PAWN;
+    const int file = ep % 8;
+    const int behind = white ? ep - 8 : ep + 8; // rank our capturing pawns stand on
+
+    if (file != 0 && b.board[behind - 1] == pawn) return ep;
+    if (file != 7 && b.board[behind + 1] == pawn) return ep;
+    return -1;
+}
+
+PackedPosition pack_position(const Board& b) {
+    PackedPosition p;
+    std::memset(&p, 0, sizeof(p));
+
+    int n = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        Piece piece = b.board[sq];
+        if (piece == EMPTY) continue;
+
+        p.occupancy |= uint64_t{1} << sq;
+        if (n < 32) p.pieces[n / 2] |= static_cast<uint8_t>(piece) << (4 * (n % 2));
+        n++;
+    }
+
+    p.flags = static_cast<uint8_t>((b.side_to_move == BLACK ? 1 : 0) | (live_castling_rights(b) << 1));
+    p.en_passant = static_cast<int8_t>(live_en_passant(b));
+
+    return p;
+}
+
+bool unpack_position(const PackedPosition& p, Board& b) {
+    b.board.fill(EMPTY);
+
+    int n = 0;
+    int white_kings = 0, black_kings = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        if (!(p.occupancy >> sq & 1)) continue;
+        if (n >= 32) return false;
+
+        int nibble = (p.pieces[n / 2] >> (4 * (n % 2))) & 0xF;
+        if (nibble >= EMPTY) return false;
+
+        b.board[sq] = static_cast<Piece>(nibble);
+        if (nibble == W_KING) white_kings++;
+        if (nibble == B_KING) black_kings++;
+        n++;
+    }
+    if (white_kings != 1 || black_kings != 1) return false;
+
+    b.side_to_move = (p.flags & 1) ? BLACK : WHITE;
+    b.castling_rights = (p.flags >> 1) & 0xF;
+    b.en_passant_square = (p.en_passant >= 0 && p.en_passant < 64) ? p.en_passant : -1;
+    refresh_attacks(b);
+
+    // the side that just moved can't have left its king in check
+    const Color moved = (b.side_to_move == WHITE) ? BLACK : WHITE;
+    return !is_square_attacked(b, find_king(b, moved), b.side_to_move);
+}
+
+uint64_t packed_hash(const PackedPosition& p) {
+    uint64_t words[4];
+    std::memcpy(words, &p, sizeof(words));
+
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (uint64_t w : words) {
+        h ^= w;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+PositionSet::PositionSet(size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) capacity *= 2;
+
+    slots_.assign(capacity, PackedPosition{});
+    mask_ = capacity - 1;
+}
+
+bool PositionSet::insert(const PackedPosition& packed) {
+    if ((count_ + 1) * 2 > slots_.size()) grow(); // keep load under one half
+
+    size_t i = packed_hash(packed) & mask_;
+    while (slots_[i].occupancy != 0) {
+        if (slots_[i] == packed) return false;
+        i = (i + 1) & mask_;
+    }
+
+    slots_[i] = packed;
+    count_++;
+    return true;
+}
+
+bool PositionSet::contains(const PackedPosition& packed) const {
+    size_t i = packed_hash(packed) & mask_;
+    while (slots_[i].occupancy != 0) {
+        if (slots_[i] == packed) return true;
+        i = (i + 1) & mask_;
+    }
+    return false;
+}
+
+void PositionSet::grow() {
+    std::vector<PackedPosition> old;
+    old.swap(slots_);
+
+    slots_.assign(old.size() * 2, PackedPosition{});
+    mask_ = slots_.size() - 1;
+
+    for (const auto& p : old) {
+        if (p.occupancy == 0) continue;
+
+        size_t i = packed_hash(p) & mask_;
+        while (slots_[i].occupancy != 0) i = (i + 1) & mask_;
+        slots_[i] = p;
+    }
+}
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "include/mapped_file.h"
+#include "include/pgn.h"
+
+const char* result_string(GameResult result) {
+    switch (result) {
+        case RESULT_WHITE_WIN: return "1-0";
+        case RESULT_BLACK_WIN: return "0-1";
+        case RESULT_DRAW: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+static bool parse_result(std::string_view token, GameResult& result) {
+    if (token == "1-0") result = RESULT_WHITE_WIN;
+    else if (token == "0-1") result = RESULT_BLACK_WIN;
+    else if (token == "1/2-1/2") result = RESULT_DRAW;
+    else if (token == "*") result = RESULT_UNKNOWN;
+    else return false;
+    return true;
+}
+
+static bool is_legal(const Board& b, Move move) {
+    Board temp = b;
+    make_move(temp, move);
+    return !is_square_attacked(temp, find_king(temp, b.side_to_move), temp.side_to_move);
+}
+
+bool parse_san(const Board& b, std::string_view san, Move& move) {
+    while (!san.empty() && std::strchr("+#!?", san.back())) san.remove_suffix(1);
+
+    const bool white = (b.side_to_move == WHITE);
+    std::vector<Move> moves;
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        int from = white ? 4 : 60;
+        int to = from + (san.size() > 3 ? -2 : 2);
+
+        generate_square_moves(b, from, moves);
+        move = {from, to};
+        return std::find(moves.begin(), moves.end(), move) != moves.end() && is_legal(b, move);
+    }
+
+    if (san.empty()) return false;
+
+    // piece letter, white's piece; black's are six further along
+    Piece piece = W_PAWN;
+    switch (san[0]) {
+        case 'N': piece = W_KNIGHT; break;
+        case 'B': piece = W_BISHOP; break;
+        case 'R': piece = W_ROOK; break;
+        case 'Q': piece = W_QUEEN; break;
+        case 'K': piece = W_KING; break;
+        default: break;
+    }
+    if (piece != W_PAWN) san.remove_prefix(1);
+    if (!white) piece = static_cast<Piece>(piece + 6);
+
+    // promotions always make a queen here, so the piece is dropped
+    size_t eq = san.find('=');
+    if (eq != std::string_view::npos) san = san.substr(0, eq);
+    else if ((piece == W_PAWN || piece == B_PAWN) && !san.empty() && std::strchr("QRBN", san.back())) san.remove_suffix(1);
+
+    if (san.size() < 2) return false;
+
+    char file_c = san[san.size() - 2];
+    char rank_c = san[san.size() - 1];
+    if (file_c < 'a' || file_c > 'h' || rank_c < '1' || rank_c > '8') return false;
+    int to = (rank_c - '1') * 8 + (file_c - 'a');
+
+    int from_file = -1;
+    int from_rank = -1;
+    for (char c : san.substr(0, san.size() - 2)) {
+        if (c == 'x') continue;
+        if (c >= 'a' && c <= 'h') from_file = c - 'a';
+        else if (c >= '1' && c <= '8') from_rank = c - '1';
+        else return false;
+    }
+
+    // a pawn move without a file is a push straight up the file
+    if ((piece == W_PAWN || piece == B_PAWN) && from_file < 0) from_file = to % 8;
+
+    int found = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        if (b.board[sq] != piece) continue;
+        if (from_file >= 0 && sq % 8 != from_file) continue;
+        if (from_rank >= 0 && sq / 8 != from_rank) continue;
+
+        moves.clear();
+        generate_square_moves(b, sq, moves);
+        for (Move m : moves) {
+            if (m.to != to || !is_legal(b, m)) continue;
+            move = m;
+            found++;
+        }
+    }
+
+    return found == 1;
+}
+
+// replays the games in one shard of the file
+class PgnShard {
+public:
+    PgnShard(std::string_view text, int thread, const PgnCallback& on_record)
+        : text_(text), thread_(thread), on_record_(on_record) {}
+
+    void run(PgnStats& stats) {
+        while (true) {
+            skip_space();
+            if (pos_ >= text_.size()) return;
+
+            size_t before = pos_;
+            read_game(stats);
+            if (pos_ == before) pos_++; // junk we don't understand, step over it
+        }
+    }
+
+private:
+    void skip_space() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) pos_++;
+    }
+
+    void skip_past(char c) {
+        size_t p = text_.find(c, pos_);
+        pos_ = (p == std::string_view::npos) ? text_.size() : p + 1;
+    }
+
+    // ( ... ) with nesting, comments inside may hold parens
+    void skip_variation() {
+        int depth = 0;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c == '{') {
+                skip_past('}');
+                continue;
+            }
+            pos_++;
+            if (c == '(') depth++;
+            else if (c == ')' && --depth == 0) return;
+        }
+    }
+
+    // [Name "Value"]
+    void read_tag(std::string_view& name, std::string_view& value) {
+        size_t end = text_.find(']', pos_);
+        if (end == std::string_view::npos) end = text_.size();
+
+        std::string_view tag = text_.substr(pos_ + 1, end - pos_ - 1);
+        pos_ = std::min(end + 1, text_.size());
+
+        size_t space = tag.find(' ');
+        name = tag.substr(0, space);
+        value = {};
+        size_t open = tag.find('"');
+        size_t close = tag.rfind('"');
+        if (open != std::string_view::npos && close > open) value = tag.substr(open + 1, close - open - 1);
+    }
+
+    void read_game(PgnStats& stats) {
+        GameResult result = RESULT_UNKNOWN;
+        bool tagged_result = false;
+        std::string fen;
+
+        // tag pairs
+        while (true) {
+            skip_space();
+            if (pos_ >= text_.size() || text_[pos_] != '[') break;
+
+            std::string_view name, value;
+            read_tag(name, value);
+            if (name == "FEN") fen.assign(value);
+            else if (name == "Result") tagged_result = parse_result(value, result);
+        }
+
+        // movetext, up to a result token or the next game's tags
+        sans_.clear();
+        while (true) {
+            skip_space();
+            if (pos_ >= text_.size()) break;
+
+            char c = text_[pos_];
+            if (c == '[') break;
+            if (c == '{') { skip_past('}'); continue; }
+            if (c == ';') { skip_past('\n'); continue; }
+            if (c == '(') { skip_variation(); continue; }
+
+            size_t start = pos_;
+            while (pos_ < text_.size() && !std::isspace(static_cast<unsigned char>(text_[pos_]))
+                   && !std::strchr("{;()[", text_[pos_])) pos_++;
+            std::string_view token = text_.substr(start, pos_ - start);
+            if (token.empty()) { pos_++; continue; }
+
+            GameResult end_result;
+            if (parse_result(token, end_result)) {
+                if (!tagged_result) result = end_result;
+                break;
+            }
+            if (token[0] == '$') continue; // NAG
+
+            // move numbers, possibly glued to the move: 12. 12... 12.Nf3
+            size_t dot = token.find_last_of('.');
+            if (dot != std::string_view::npos) token.remove_prefix(dot + 1);
+            if (token.empty()) continue;
+
+            sans_.push_back(token);
+        }
+
+        // a game from a broken FEN tag yields no positions at all
+        if (!fen.empty() && !is_valid_fen(fen)) {
+            stats.errors++;
+            stats.games++;
+            return;
+        }
+
+        Board b;
+        if (fen.empty()) init_board(b);
+        else load_fen(b, fen);
+
+        for (std::string_view san : sans_) {
+            Move move;
+            if (!parse_san(b, san, move)) {
+                stats.errors++;
+                break;
+            }
+
+            on_record_({&b, move, result, thread_});
+            stats.positions++;
+            make_move(b, move);
+        }
+
+        stats.games++;
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    int thread_;
+    const PgnCallback& on_record_;
+    std::vector<std::string_view> sans_;
+};
+
+bool read_pgn(const std::string& path, int threads, const PgnCallback& on_record, PgnStats& stats) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    std::string_view text = file.data();
+    if (threads < 1) threads = 1;
+
+    // cut into roughly equal shards, moving each cut forward to the start of a game
+    std::vector<size_t> cuts = {0};
+    for (int i = 1; i < threads; i++) {
+        size_t nominal = std::max(cuts.back(), text.size() * i / threads);
+        size_t next = text.find("\n[Event ", nominal);
+        if (next == std::string_view::npos) break;
+        if (next + 1 > cuts.back()) cuts.push_back(next + 1);
+    }
+    cuts.push_back(text.size());
+
+    std::vector<PgnStats> shard_stats(cuts.size() - 1);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i + 1 < cuts.size(); i++) {
+        workers.emplace_back([&, i] {
+            PgnShard shard(text.substr(cuts[i], cuts[i + 1] - cuts[i]), static_cast<int>(i), on_record);
+            shard.run(shard_stats[i]);
+        });
+    }
+    for (auto& t : workers) t.join();
+
+    for (const auto& s : shard_stats) {
+        stats.games += s.games;
+        stats.positions += s.positions;
+        stats.errors += s.errors;
+    }
+
+    return true;
+}
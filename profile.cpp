@@ -0,0 +1,288 @@
+#include "include/profile.h"
+
+#ifndef CHESS_PROFILE
+
+void profile_report(std::ostream& out) {
+    out << "info string profiling is not compiled in, build with make profile" << std::endl;
+}
+
+void profile_reset() {}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// log2 buckets of ticks per call
+constexpr int kBuckets = 48;
+
+struct ProbeStats {
+    uint64_t calls = 0;
+    uint64_t ticks = 0;
+    uint64_t histogram[kBuckets] = {};
+    PerfCounts perf;
+
+    void add(const ProbeStats& o) {
+        calls += o.calls;
+        ticks += o.ticks;
+        for (int i = 0; i < kBuckets; i++) histogram[i] += o.histogram[i];
+        perf.cycles += o.perf.cycles;
+        perf.instructions += o.perf.instructions;
+        perf.cache_misses += o.perf.cache_misses;
+    }
+
+    void subtract(const ProbeStats& o) {
+        calls -= o.calls;
+        ticks -= o.ticks;
+        for (int i = 0; i < kBuckets; i++) histogram[i] -= o.histogram[i];
+        perf.cycles -= o.perf.cycles;
+        perf.instructions -= o.perf.instructions;
+        perf.cache_misses -= o.perf.cache_misses;
+    }
+};
+
+// the live counters of one thread. only the owning thread writes them, so
+// an add is a relaxed load and store (plain moves on x86); profile_report
+// reads them from other threads while they run.
+struct ProbeCounters {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> histogram[kBuckets] = {};
+    std::atomic<uint64_t> cycles{0};
+    std::atomic<uint64_t> instructions{0};
+    std::atomic<uint64_t> cache_misses{0};
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    ProbeStats snapshot() const {
+        ProbeStats s;
+        s.calls = calls.load(std::memory_order_relaxed);
+        s.ticks = ticks.load(std::memory_order_relaxed);
+        for (int i = 0; i < kBuckets; i++) s.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+        s.perf.cycles = cycles.load(std::memory_order_relaxed);
+        s.perf.instructions = instructions.load(std::memory_order_relaxed);
+        s.perf.cache_misses = cache_misses.load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+struct ThreadProfile;
+
+static std::mutex registry_mutex;
+static std::vector<ThreadProfile*> registry;
+static ProbeStats retired[PROBE_COUNT]; // threads that already exited
+// totals at the last profile_reset. counters are never cleared, since
+// other threads own them; reports subtract this instead.
+static ProbeStats baseline[PROBE_COUNT];
+
+struct ThreadProfile {
+    ProbeCounters probes[PROBE_COUNT];
+    int perf_fds[3] = {-1, -1, -1}; // cycles (the group leader), instructions, cache misses
+    bool perf_tried = false;
+
+    ThreadProfile() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(this);
+    }
+
+    ~ThreadProfile() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (int i = 0; i < PROBE_COUNT; i++) retired[i].add(probes[i].snapshot());
+        registry.erase(std::find(registry.begin(), registry.end(), this));
+#ifdef __linux__
+        for (int fd : perf_fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+};
+
+static thread_local ThreadProfile thread_profile;
+
+static const char* probe_names[PROBE_COUNT] = {
+    "generate_pseudo_moves",
+    "generate_moves",
+    "  legality_filter",
+    "is_square_attacked",
+    "make_move",
+    "unmake_move",
+    "evaluate",
+};
+
+bool profile_perf_enabled() {
+    static const bool enabled = [] {
+        const char* env = std::getenv("CHESS_PROFILE_PERF");
+        return env && std::strcmp(env, "0") != 0;
+    }();
+    return enabled;
+}
+
+#ifdef __linux__
+
+static int open_counter(uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// one counter group per thread: cycles (leader), instructions, cache misses
+static int thread_perf_fd() {
+    ThreadProfile& tp = thread_profile;
+    if (tp.perf_tried) return tp.perf_fds[0];
+    tp.perf_tried = true;
+
+    int fds[3] = {-1, -1, -1};
+    fds[0] = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (fds[0] >= 0) fds[1] = open_counter(PERF_COUNT_HW_INSTRUCTIONS, fds[0]);
+    if (fds[1] >= 0) fds[2] = open_counter(PERF_COUNT_HW_CACHE_MISSES, fds[0]);
+
+    if (fds[2] < 0) {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+        return -1;
+    }
+
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    std::copy(fds, fds + 3, tp.perf_fds);
+    return fds[0];
+}
+
+PerfCounts profile_read_perf() {
+    PerfCounts counts;
+
+    int fd = thread_perf_fd();
+    if (fd < 0) return counts;
+
+    struct {
+        uint64_t nr;
+        uint64_t values[3];
+    } data;
+
+    if (read(fd, &data, sizeof(data)) == static_cast<ssize_t>(sizeof(data)) && data.nr == 3) {
+        counts.cycles = data.values[0];
+        counts.instructions = data.values[1];
+        counts.cache_misses = data.values[2];
+    }
+    return counts;
+}
+
+#else
+
+PerfCounts profile_read_perf() {
+    return {};
+}
+
+#endif
+
+void profile_record(ProfileProbe probe, uint64_t ticks, const PerfCounts& start) {
+    ProbeCounters& s = thread_profile.probes[probe];
+    ProbeCounters::bump(s.calls, 1);
+    ProbeCounters::bump(s.ticks, ticks);
+
+    int bucket = 0;
+    while (bucket < kBuckets - 1 && (ticks >> (bucket + 1)) != 0) bucket++;
+    ProbeCounters::bump(s.histogram[bucket], 1);
+
+    if (profile_perf_enabled()) {
+        PerfCounts end = profile_read_perf();
+        ProbeCounters::bump(s.cycles, end.cycles - start.cycles);
+        ProbeCounters::bump(s.instructions, end.instructions - start.instructions);
+        ProbeCounters::bump(s.cache_misses, end.cache_misses - start.cache_misses);
+    }
+}
+
+// upper edge of the bucket holding the q-th quantile
+static uint64_t quantile(const ProbeStats& s, double q) {
+    uint64_t target = static_cast<uint64_t>(q * s.calls);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += s.histogram[i];
+        if (seen > target) return (uint64_t{2} << i) - 1;
+    }
+    return 0;
+}
+
+// everything recorded so far, over live and exited threads. the caller
+// holds registry_mutex.
+static void collect_totals(ProbeStats (&total)[PROBE_COUNT]) {
+    for (int i = 0; i < PROBE_COUNT; i++) {
+        total[i] = retired[i];
+        for (const ThreadProfile* tp : registry) total[i].add(tp->probes[i].snapshot());
+    }
+}
+
+void profile_report(std::ostream& out) {
+    ProbeStats total[PROBE_COUNT];
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        collect_totals(total);
+        for (int i = 0; i < PROBE_COUNT; i++) total[i].subtract(baseline[i]);
+    }
+
+    // probes nest (generate_moves calls make_move), so shares are inclusive
+    // and relative to the most expensive probe
+    uint64_t top = 1;
+    for (const auto& s : total) top = std::max(top, s.ticks);
+
+    const bool perf = profile_perf_enabled();
+    char line[256];
+
+    std::snprintf(line, sizeof(line), "%-24s %12s %14s %6s %8s %8s %8s", "probe", "calls", "ticks",
+                  "share", "avg", "p50<=", "p99<=");
+    out << "info string " << line << (perf ? "      ipc  miss/call" : "") << std::endl;
+
+    for (int i = 0; i < PROBE_COUNT; i++) {
+        const ProbeStats& s = total[i];
+        double avg = s.calls ? static_cast<double>(s.ticks) / s.calls : 0.0;
+
+        std::snprintf(line, sizeof(line), "%-24s %12llu %14llu %5.1f%% %8.1f %8llu %8llu", probe_names[i],
+                      static_cast<unsigned long long>(s.calls), static_cast<unsigned long long>(s.ticks),
+                      100.0 * s.ticks / top, avg,
+                      static_cast<unsigned long long>(quantile(s, 0.5)),
+                      static_cast<unsigned long long>(quantile(s, 0.99)));
+        out << "info string " << line;
+
+        if (perf) {
+            double ipc = s.perf.cycles ? static_cast<double>(s.perf.instructions) / s.perf.cycles : 0.0;
+            double misses = s.calls ? static_cast<double>(s.perf.cache_misses) / s.calls : 0.0;
+            std::snprintf(line, sizeof(line), " %8.2f %10.3f", ipc, misses);
+            out << line;
+        }
+        out << std::endl;
+    }
+
+    if (perf && total[0].perf.cycles == 0 && total[0].calls > 0) {
+        out << "info string perf counters unavailable (check /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+    }
+}
+
+void profile_reset() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    collect_totals(baseline);
+}
+
+#endif
@@ -0,0 +1,331 @@
+#include "include/server.h"
+
+#ifdef _WIN32
+
+#include <iostream>
+
+int run_server(const ServerOptions&) {
+    std::cerr << "serve mode needs unix domain sockets" << std::endl;
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "include/engine.h"
+#include "include/thread_pool.h"
+#include "include/uci.h"
+
+using Clock = std::chrono::steady_clock;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) {
+    stop_requested = 1;
+}
+
+struct Metrics {
+    Clock::time_point started = Clock::now();
+    std::atomic<uint64_t> sessions{0};
+    std::atomic<uint64_t> jobs{0};
+    std::atomic<uint64_t> searches{0};
+    std::atomic<uint64_t> queue_us_total{0};
+    std::atomic<uint64_t> queue_us_max{0};
+};
+
+struct Session {
+    Session(int fd, size_t hash_mb) : fd(fd), engine(hash_mb) {}
+    ~Session() { close(fd); }
+
+    int fd;
+    Engine engine;
+    std::string inbuf; // io thread only
+
+    // guarded by mutex. scheduled is true while a drain job is queued or running,
+    // so at most one job per session is ever in the pool.
+    std::mutex mutex;
+    std::deque<std::string> pending;
+    int stopped_gos = 0; // queued go lines a stop arrived after
+    bool scheduled = false;
+    bool closed = false;
+};
+
+struct Server {
+    ServerOptions options;
+    Metrics metrics;
+    ThreadPool pool; // last, so it joins before the rest goes away
+
+    explicit Server(const ServerOptions& opts)
+        : options(opts),
+          pool(opts.threads > 0 ? opts.threads
+                                : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))) {}
+};
+
+static void send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return; // peer went away, the io thread will notice
+        sent += static_cast<size_t>(n);
+    }
+}
+
+static std::string metrics_line(Server& server) {
+    const Metrics& m = server.metrics;
+    double secs = std::chrono::duration<double>(Clock::now() - m.started).count();
+    uint64_t jobs = m.jobs.load();
+
+    std::ostringstream out;
+    out << "info string metrics sessions " << m.sessions.load()
+        << " threads " << server.pool.size()
+        << " searches " << m.searches.load()
+        << " sps " << static_cast<uint64_t>(secs > 0 ? m.searches.load() / secs : 0)
+        << " queue_avg_us " << (jobs ? m.queue_us_total.load() / jobs : 0)
+        << " queue_max_us " << m.queue_us_max.load() << "\n";
+    return out.str();
+}
+
+static void schedule(Server& server, std::shared_ptr<Session> session);
+
+// runs queued commands for one session. after each search the job goes back
+// to the end of the pool queue, so one busy session can't starve the rest.
+static void drain(Server& server, std::shared_ptr<Session> session, Clock::time_point queued) {
+    uint64_t waited = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - queued).count();
+    server.metrics.jobs++;
+    server.metrics.queue_us_total += waited;
+    uint64_t prev_max = server.metrics.queue_us_max.load();
+    while (waited > prev_max && !server.metrics.queue_us_max.compare_exchange_weak(prev_max, waited)) {}
+
+    while (true) {
+        std::vector<std::string> tokens;
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->closed || session->pending.empty()) {
+                session->scheduled = false;
+                return;
+            }
+            tokens = split_tokens(session->pending.front());
+            session->pending.pop_front();
+
+            // a stop that came while this go was queued was counted in
+            // stopped_gos; it still owes the client a bestmove, so it runs as
+            // the shortest search there is. one coming from here on has to
+            // reach the search even before it starts, which arm_stop sees to.
+            if (!tokens.empty() && tokens[0] == "go") {
+                if (session->stopped_gos > 0) {
+                    session->stopped_gos--;
+                    tokens = {"go", "depth", "1"};
+                }
+                session->engine.arm_stop();
+            }
+        }
+        if (tokens.empty()) continue;
+
+        if (tokens[0] == "metrics") {
+            send_all(session->fd, metrics_line(server));
+            continue;
+        }
+
+        // sessions don't get to touch files on the server
+        if (tokens[0] == "trace" || tokens[0] == "save_hash" || tokens[0] == "load_hash") {
+            send_all(session->fd, "info string " + tokens[0] + " is not available on the server\n");
+            continue;
+        }
+
+        // hash is budgeted per session
+        if (tokens[0] == "setoption" && tokens.size() >= 5 && tokens[1] == "name" && tokens[2] == "Hash" &&
+            tokens[3] == "value") {
+            try {
+                size_t mb = static_cast<size_t>(std::max(1, std::stoi(tokens[4])));
+                tokens[4] = std::to_string(std::min(mb, server.options.max_session_hash_mb));
+            } catch (...) {
+                continue;
+            }
+        }
+
+        std::ostringstream out;
+        bool keep = handle_uci_command(session->engine, tokens, out);
+        send_all(session->fd, out.str());
+
+        if (!keep) {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->closed = true;
+            session->scheduled = false;
+            shutdown(session->fd, SHUT_RDWR); // io thread sees eof and drops it
+            return;
+        }
+
+        if (tokens[0] == "go") {
+            server.metrics.searches++;
+
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->pending.empty()) {
+                session->scheduled = false;
+                return;
+            }
+            break; // still scheduled, requeue below
+        }
+    }
+
+    schedule(server, session);
+}
+
+static void schedule(Server& server, std::shared_ptr<Session> session) {
+    Clock::time_point now = Clock::now();
+    server.pool.submit([&server, session, now] { drain(server, session, now); });
+}
+
+// splits newly read bytes into lines and queues them on the session
+static void on_input(Server& server, const std::shared_ptr<Session>& session, const char* data, size_t len) {
+    session->inbuf.append(data, len);
+
+    size_t pos;
+    while ((pos = session->inbuf.find('\n')) != std::string::npos) {
+        std::string line = session->inbuf.substr(0, pos);
+        session->inbuf.erase(0, pos + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        // stop has to reach a running search right away, not wait its turn
+        if (line == "stop") {
+            // under the lock, so every go is either still queued and counted
+            // here or already armed in drain
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->stopped_gos = static_cast<int>(std::count_if(
+                session->pending.begin(), session->pending.end(), [](const std::string& l) {
+                    auto tokens = split_tokens(l);
+                    return !tokens.empty() && tokens[0] == "go";
+                }));
+            session->engine.stop();
+            continue;
+        }
+
+        bool submit = false;
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->closed) return;
+            session->pending.push_back(std::move(line));
+            if (!session->scheduled) {
+                session->scheduled = true;
+                submit = true;
+            }
+        }
+        if (submit) schedule(server, session);
+    }
+}
+
+int run_server(const ServerOptions& options) {
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (options.socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "socket path too long" << std::endl;
+        close(listen_fd);
+        return 1;
+    }
+    std::strcpy(addr.sun_path, options.socket_path.c_str());
+    unlink(options.socket_path.c_str());
+
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+        || listen(listen_fd, SOMAXCONN) < 0) {
+        std::cerr << "bind/listen " << options.socket_path << ": " << std::strerror(errno) << std::endl;
+        close(listen_fd);
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    std::map<int, std::shared_ptr<Session>> sessions;
+    {
+        Server server(options);
+        std::cerr << "serving on " << options.socket_path << " with "
+                  << server.pool.size() << " threads" << std::endl;
+
+        std::vector<pollfd> fds;
+        char buf[4096];
+
+        while (!stop_requested) {
+            fds.clear();
+            fds.push_back({listen_fd, POLLIN, 0});
+            for (const auto& entry : sessions) fds.push_back({entry.first, POLLIN, 0});
+
+            int ready = poll(fds.data(), fds.size(), 250);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "poll: " << std::strerror(errno) << std::endl;
+                break;
+            }
+
+            for (size_t i = 1; i < fds.size(); i++) {
+                if (!fds[i].revents) continue;
+
+                auto it = sessions.find(fds[i].fd);
+                ssize_t n = read(fds[i].fd, buf, sizeof(buf));
+                if (n > 0) {
+                    on_input(server, it->second, buf, static_cast<size_t>(n));
+                    continue;
+                }
+
+                // eof or error: drop the session. a running job keeps it
+                // alive until it returns, then the fd is closed.
+                {
+                    std::lock_guard<std::mutex> lock(it->second->mutex);
+                    it->second->closed = true;
+                }
+                it->second->engine.stop();
+                sessions.erase(it);
+                server.metrics.sessions--;
+            }
+
+            if (fds[0].revents & POLLIN) {
+                int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd >= 0) {
+                    sessions[fd] = std::make_shared<Session>(fd, options.session_hash_mb);
+                    server.metrics.sessions++;
+                }
+            }
+        }
+
+        for (auto& entry : sessions) {
+            {
+                std::lock_guard<std::mutex> lock(entry.second->mutex);
+                entry.second->closed = true;
+            }
+            entry.second->engine.stop();
+        }
+        // the pool joins here, after any running searches return
+    }
+
+    sessions.clear();
+    close(listen_fd);
+    unlink(options.socket_path.c_str());
+    return 0;
+}
+
+#endif
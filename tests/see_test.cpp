@@ -0,0 +1,58 @@
+#include <iostream>
+#include <string>
+
+#include "../include/board.h"
+
+// exact see() results on exchanges that are easy to get wrong. values are
+// the engine's: P 100, N 320, B 330, R 500, Q 900.
+
+static int failures = 0;
+
+static void expect_see(const std::string& name, const std::string& fen, const std::string& move, int expected) {
+    Board b;
+    load_fen(b, fen);
+
+    int got = see(b, parse_move(move));
+    if (got != expected) {
+        std::cerr << "FAIL " << name << ": see(" << move << ") = " << got << ", expected " << expected << std::endl;
+        failures++;
+    }
+}
+
+int main() {
+    // plain exchanges
+    expect_see("undefended pawn", "4k3/8/8/3p4/8/8/8/3QK3 w - - 0 1", "d1d5", 100);
+    expect_see("defended QxP", "4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1", "d1d5", -800);
+    expect_see("defended RxN", "4k3/8/4p3/3n4/8/8/8/3RK3 w - - 0 1", "d1d5", -180);
+
+    // x-rays: a slider behind the first attacker joins once it has moved
+    expect_see("rook battery", "3r2k1/8/8/3p4/8/8/3R4/3R2K1 w - - 0 1", "d2d5", 100);
+    expect_see("single rook", "3r2k1/8/8/3p4/8/8/3R4/6K1 w - - 0 1", "d2d5", -400);
+    expect_see("queen behind rook", "3r2k1/8/8/3p4/8/8/3R4/3Q2K1 w - - 0 1", "d2d5", 100);
+    expect_see("queen behind rook, doubled defence", "3r2k1/3r4/8/3p4/8/8/3R4/3Q2K1 w - - 0 1", "d2d5", -400);
+    expect_see("bishop behind queen", "6k1/8/4p3/3p4/2Q5/1B6/8/4K3 w - - 0 1", "c4d5", -700);
+    expect_see("queen behind bishop", "6k1/8/4p3/3p4/2B5/1Q6/8/4K3 w - - 0 1", "c4d5", -130);
+
+    // en passant takes the pawn beside the target square
+    expect_see("en passant", "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100);
+    expect_see("defended en passant", "4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 0);
+    expect_see("black en passant", "4k3/8/8/8/3Pp3/8/8/4K3 b - d3 0 1", "e4d3", 100);
+
+    // promotions make a queen, which is then what the defender takes
+    expect_see("promotion capture", "r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7a8", 1300);
+    expect_see("promotion capture, recaptured", "r3k3/1Pn5/8/8/8/8/8/4K3 w - - 0 1", "b7a8", 400);
+    expect_see("promotion push, recaptured", "r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8", -100);
+
+    // a king only recaptures onto a square nothing defends
+    expect_see("king recaptures", "4k3/3p4/8/8/8/8/3R4/4K3 w - - 0 1", "d2d7", -400);
+    expect_see("king can't recapture", "4k3/3p4/8/1B6/8/8/3R4/4K3 w - - 0 1", "d2d7", 100);
+    expect_see("white king recaptures", "4k3/4r3/8/8/8/8/4P3/4K3 b - - 0 1", "e7e2", -400);
+    expect_see("x-ray keeps the king off", "4q1k1/4r3/8/8/8/8/4P3/4K3 b - - 0 1", "e7e2", 100);
+
+    if (failures) {
+        std::cerr << failures << " see test(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "see tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../include/tune.h"
+
+// is_valid_fen and the tuner's loader on good, noisy and malformed lines,
+// and the tuner's features against evaluate()
+
+static int failures = 0;
+
+static void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL " << what << std::endl;
+        failures++;
+    }
+}
+
+static double dot(const TuneSet& set, const TuneParams& params, size_t i) {
+    double eval = 0.0;
+    for (uint32_t j = set.begin[i]; j < set.begin[i + 1]; j++) eval += params[set.feature[j]] * set.count[j];
+    return eval;
+}
+
+int main() {
+    const char* good[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "8/5k2/8/3P4/8/2N5/5K2/8 b - -", // no move counters
+    };
+    const char* bad[] = {
+        "ZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZZ w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR/8 w KQkq - 0 1", // nine ranks
+        "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",   // nine files
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1",    // seven files
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",   // side to move
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq z9 0 1",  // en passant square
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w",              // missing fields
+        "8/8/8/8/8/8/8/8/8/8/pppppppp w - - 0 1",                     // eleven ranks
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e3 0 1",  // en passant on the mover's side
+        "8/8/8/3p4/8/8/8/3Q4 w - - 0 1",                              // no kings
+        "4k3/8/8/8/8/8/8/3KK3 w - - 0 1",                             // two white kings
+        "4k3/8/8/8/8/8/8/4R1K1 w - - 0 1",                            // black left in check
+        "",
+    };
+
+    // the shared validator every FEN entry point uses
+    for (const char* fen : good) expect(is_valid_fen(fen), std::string("valid: ") + fen);
+    for (const char* fen : bad) expect(!is_valid_fen(fen), std::string("invalid: ") + fen);
+
+    const auto path = std::filesystem::temp_directory_path() / "chess_engine_tune_test.tsv";
+    {
+        std::ofstream out(path);
+        for (const char* fen : good) out << fen << "\tx\t1-0\n";
+        for (const char* fen : bad) out << fen << "\tx\t0-1\n";
+        out << good[0] << "\tx\t*\n";                                                // no result
+        out << "4k3/8/8/8/8/8/8/R3K3 b - - 0 1\tx\t1/2-1/2\n";                        // not in check, kept
+        out << "4k3/8/8/8/8/8/8/4R1K1 b - - 0 1\tx\t1-0\r\n";                        // in check
+        out << "4k3/8/8/3p4/8/8/8/3QK3 w - - 0 1\tx\t1-0\n";                          // QxP wins a pawn
+    }
+
+    for (int threads : {1, 3}) {
+        TuneSet set;
+        uint64_t skipped = 0;
+        std::string error;
+        const std::string name = std::to_string(threads) + " thread(s): ";
+
+        expect(load_tune_set(path.string(), threads, set, skipped, error), name + "load failed: " + error);
+        expect(set.size() == 4, name + "kept " + std::to_string(set.size()) + " positions, expected 4");
+        expect(skipped == std::size(bad) + 3, name + "skipped " + std::to_string(skipped) + " lines, expected " +
+                                                  std::to_string(std::size(bad) + 3));
+        expect(set.begin.size() == set.size() + 1, name + "begin has one entry per position plus one");
+    }
+
+    // the features reproduce evaluate() exactly
+    const TuneParams params = current_params();
+    for (const char* fen : good) {
+        Board b;
+        load_fen(b, fen);
+        TuneSet set;
+        add_position(set, b, 0.5f);
+        expect(static_cast<int>(dot(set, params, 0)) == evaluate(b), std::string("features of ") + fen);
+    }
+
+    // a short run writes a header
+    TuneOptions options;
+    options.path = path.string();
+    options.out_path = (std::filesystem::temp_directory_path() / "chess_engine_tune_test.h").string();
+    options.threads = 2;
+    options.iterations = 5;
+    std::ostringstream log;
+    expect(run_tune(options, log) == 0, "run_tune failed: " + log.str());
+    expect(std::filesystem::file_size(options.out_path) > 0, "no header written");
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(options.out_path);
+
+    if (failures) {
+        std::cerr << failures << " tune test(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "tune tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "include/pgn.h"
+#include "include/testsuite.h"
+#include "include/thread_pool.h"
+
+bool parse_epd(const std::string& line, EpdEntry& entry, std::string& error) {
+    std::istringstream in(line);
+    std::string fields[4];
+    for (auto& f : fields) {
+        if (!(in >> f)) {
+            error = "not an EPD line";
+            return false;
+        }
+    }
+    const std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1";
+    if (!is_valid_fen(fen)) {
+        error = "bad position";
+        return false;
+    }
+    load_fen(entry.board, fen);
+
+    std::string rest;
+    std::getline(in, rest);
+
+    // operations end in ';', except that one may sit inside a quoted string
+    std::vector<std::string> ops;
+    std::string op;
+    bool quoted = false;
+    for (char c : rest) {
+        if (c == '"') quoted = !quoted;
+        if (c == ';' && !quoted) {
+            ops.push_back(op);
+            op.clear();
+        } else {
+            op += c;
+        }
+    }
+    ops.push_back(op);
+
+    for (const auto& text : ops) {
+        std::istringstream op_in(text);
+        std::string opcode;
+        if (!(op_in >> opcode)) continue;
+
+        if (opcode == "id") {
+            std::string id;
+            std::getline(op_in >> std::ws, id);
+            id.erase(std::remove(id.begin(), id.end(), '"'), id.end());
+            entry.id = id;
+            continue;
+        }
+        if (opcode != "bm" && opcode != "am") continue;
+
+        std::vector<Move>& moves = (opcode == "bm") ? entry.best : entry.avoid;
+        std::string san;
+        while (op_in >> san) {
+            Move move;
+            if (!parse_san(entry.board, san, move)) {
+                error = "can't resolve " + opcode + " " + san;
+                return false;
+            }
+            moves.push_back(move);
+        }
+        if (!entry.expected.empty()) entry.expected += ' ';
+        entry.expected += opcode + text.substr(text.find(opcode) + opcode.size());
+    }
+
+    if (entry.best.empty() && entry.avoid.empty()) {
+        error = "no bm or am";
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+struct PositionResult {
+    bool solved = false;
+    Move found = {-1, -1};
+    int depth = 0;
+    double ms = 0;      // whole search
+    uint64_t nodes = 0;
+    double solve_ms = 0; // at the first iteration of the final correct run
+    uint64_t solve_nodes = 0;
+    int solve_depth = 0;
+};
+
+bool is_correct(const EpdEntry& entry, Move move) {
+    if (!entry.best.empty() && std::find(entry.best.begin(), entry.best.end(), move) == entry.best.end()) return false;
+    return std::find(entry.avoid.begin(), entry.avoid.end(), move) == entry.avoid.end();
+}
+
+PositionResult solve(const EpdEntry& entry, const TestsuiteOptions& options) {
+    PositionResult r;
+    Engine engine(options.hash_mb);
+    engine.set_position(entry.board);
+
+    const auto start = std::chrono::steady_clock::now();
+    bool stable = false;
+
+    SearchResult result = engine.search(options.limits, [&](const SearchResult& it) {
+        if (it.lines.empty()) return;
+
+        const bool ok = is_correct(entry, it.lines[0].move);
+        if (ok && !stable) {
+            r.solve_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            r.solve_nodes = it.nodes;
+            r.solve_depth = it.depth;
+        }
+        stable = ok;
+    });
+
+    r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    r.nodes = result.nodes;
+    r.depth = result.depth;
+    if (!result.lines.empty()) {
+        r.found = result.lines[0].move;
+        r.solved = stable;
+    }
+    return r;
+}
+
+template <typename T>
+T percentile(std::vector<T> values, double p) {
+    if (values.empty()) return T{};
+    std::sort(values.begin(), values.end());
+    size_t i = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[i];
+}
+
+} // namespace
+
+int run_testsuite(const TestsuiteOptions& options, std::ostream& out) {
+    std::ifstream in(options.path);
+    if (!in) {
+        out << "cannot read " << options.path << std::endl;
+        return 1;
+    }
+
+    std::vector<EpdEntry> entries;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') continue;
+
+        EpdEntry entry;
+        std::string error;
+        if (!parse_epd(line, entry, error)) {
+            out << "line " << line_number << ": " << error << ", skipped" << std::endl;
+            continue;
+        }
+        if (entry.id.empty()) entry.id = "line " + std::to_string(line_number);
+        entries.push_back(std::move(entry));
+    }
+
+    int threads = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<PositionResult> results(entries.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+        // the pool finishes every job before it goes away
+        ThreadPool pool(std::max(1, threads));
+        for (size_t i = 0; i < entries.size(); i++) {
+            pool.submit([&, i] { results[i] = solve(entries[i], options); });
+        }
+    }
+    const double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> solve_ms;
+    std::vector<uint64_t> solve_nodes;
+    uint64_t total_nodes = 0;
+
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < entries.size(); i++) {
+        const PositionResult& r = results[i];
+        total_nodes += r.nodes;
+
+        out << entries[i].id << "  " << (r.solved ? "solved" : "FAILED") << "  " << entries[i].expected
+            << "  got " << index_to_square(r.found.from) << index_to_square(r.found.to) << "  depth " << r.depth;
+        if (r.solved) {
+            out << "  at depth " << r.solve_depth << " " << r.solve_ms << " ms " << r.solve_nodes << " nodes";
+            solve_ms.push_back(r.solve_ms);
+            solve_nodes.push_back(r.solve_nodes);
+        }
+        out << '\n';
+    }
+
+    const size_t solved = solve_ms.size();
+    out << "\nsolved " << solved << " / " << entries.size();
+    if (!entries.empty()) out << " (" << 100.0 * solved / entries.size() << "%)";
+    out << "  threads " << threads << "  wall " << wall_ms << " ms  nodes " << total_nodes << '\n';
+
+    if (solved) {
+        out << "time to solve ms:  p50 " << percentile(solve_ms, 0.5) << "  p90 " << percentile(solve_ms, 0.9)
+            << "  max " << percentile(solve_ms, 1.0) << '\n';
+        out << "nodes to solve:    p50 " << percentile(solve_nodes, 0.5) << "  p90 " << percentile(solve_nodes, 0.9)
+            << "  max " << percentile(solve_nodes, 1.0) << '\n';
+    }
+
+    // cumulative, so two builds compare bucket by bucket
+    out << "solved within:\n";
+    for (double limit : {1.0, 10.0, 100.0, 1000.0, 10000.0}) {
+        size_t n = std::count_if(solve_ms.begin(), solve_ms.end(), [limit](double ms) { return ms <= limit; });
+        out << "  " << std::setw(6) << std::setprecision(0) << limit << " ms  " << std::setw(5) << n << '\n';
+    }
+    out << "  " << std::setw(9) << "any" << "  " << std::setw(5) << solved << std::endl;
+
+    return 0;
+}
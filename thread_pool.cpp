@@ -0,0 +1,72 @@
+#include "include/thread_pool.h"
+
+// index of the pool worker running on this thread, -1 elsewhere
+static thread_local int current_worker = -1;
+static thread_local const ThreadPool* current_pool = nullptr;
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads < 1) threads = 1;
+
+    for (int i = 0; i < threads; i++) queues_.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < threads; i++) workers_.emplace_back([this, i] { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& t : workers_) t.join();
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    int index = (current_pool == this) ? current_worker
+                                       : static_cast<int>(next_++ % queues_.size());
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->jobs.push_back(std::move(job));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        pending_++;
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::pop(int index, std::function<void()>& job) {
+    const int n = static_cast<int>(queues_.size());
+
+    for (int k = 0; k < n; k++) {
+        Queue& q = *queues_[(index + k) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.empty()) continue;
+
+        job = std::move(q.jobs.front());
+        q.jobs.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::worker_loop(int index) {
+    current_worker = index;
+    current_pool = this;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+            if (pending_ == 0) return; // stopping and drained
+            pending_--;
+        }
+
+        // pending_ counted one job for us, so some queue holds it
+        std::function<void()> job;
+        while (!pop(index, job)) std::this_thread::yield();
+        job();
+    }
+}
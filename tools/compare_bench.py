@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""Compare two microbench JSON files and flag slowdowns.
+
+    tools/compare_bench.py old.json new.json [--threshold 5]
+
+Exits with status 1 if any benchmark's median got slower by more than
+the threshold (percent).
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b for b in json.load(f)["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="percent slowdown of the median treated as noise")
+    args = parser.parse_args()
+
+    old = load(args.old)
+    new = load(args.new)
+
+    regressed = False
+    print(f"{'benchmark':<24} {'old ns':>10} {'new ns':>10} {'change':>8}")
+    for name in sorted(old.keys() | new.keys()):
+        if name not in old or name not in new:
+            print(f"{name:<24} {'only in ' + ('new' if name in new else 'old'):>30}")
+            continue
+
+        before = old[name]["median_ns"]
+        after = new[name]["median_ns"]
+        change = 100.0 * (after - before) / before if before else 0.0
+
+        flag = ""
+        if change > args.threshold:
+            flag = "  SLOWER"
+            regressed = True
+        elif change < -args.threshold:
+            flag = "  faster"
+
+        print(f"{name:<24} {before:>10.1f} {after:>10.1f} {change:>+7.1f}%{flag}")
+
+    return 1 if regressed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
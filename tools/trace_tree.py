@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Rebuild and summarize search trees from a `trace` file.
+
+    tools/trace_tree.py search.trace [--tree N] [--path e2e4,e7e5] [--show DEPTH]
+
+Every finished root iteration in the file is one tree. By default the last
+tree is reported; --tree picks another (0 is the first). --path walks down
+to a subtree by its moves, and --show prints that subtree to the given depth
+below it. The report gives nodes, effective branching factor and cutoff
+reasons per ply.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"CETRC01\n"
+NODE = struct.Struct("<iiiBbbB")
+CHUNK = struct.Struct("<II")
+
+REASONS = ["exact", "fail-low", "cutoff", "hash", "mate", "stalemate",
+           "stand-pat", "quiesce", "stopped", "root"]
+
+
+class Node:
+    __slots__ = ("alpha", "beta", "score", "ply", "move", "reason", "children")
+
+    def __init__(self, alpha, beta, score, ply, frm, to, reason):
+        self.alpha = alpha
+        self.beta = beta
+        self.score = score
+        self.ply = ply
+        self.move = square(frm) + square(to) if frm >= 0 else "root"
+        self.reason = REASONS[reason] if reason < len(REASONS) else str(reason)
+        self.children = []
+
+
+def square(index):
+    return "abcdefgh"[index % 8] + str(index // 8 + 1)
+
+
+def read_streams(path):
+    """Node records per search thread, in the order they were written."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(MAGIC):
+        sys.exit(f"{path}: not a trace file")
+
+    streams = {}
+    pos = len(MAGIC)
+    while pos + CHUNK.size <= len(data):
+        thread, count = CHUNK.unpack_from(data, pos)
+        pos += CHUNK.size
+        end = pos + count * NODE.size
+        streams.setdefault(thread, []).extend(NODE.iter_unpack(data[pos:end]))
+        pos = end
+    return streams
+
+
+def build_trees(records):
+    """Nodes come children first, so each node adopts whatever is waiting
+    one ply below it. Every node that closes at ply 0 is a whole tree."""
+    pending = {}
+    trees = []
+    for rec in records:
+        node = Node(*rec)
+        node.children = pending.pop(node.ply + 1, [])
+        if node.ply == 0:
+            trees.append(node)
+        else:
+            pending.setdefault(node.ply, []).append(node)
+    return trees
+
+
+def walk(root):
+    stack = [root]
+    while stack:
+        node = stack.pop()
+        yield node
+        stack.extend(reversed(node.children))
+
+
+def report(root, base_ply):
+    nodes = {}
+    reasons = {}
+    first_cuts = {}
+
+    for node in walk(root):
+        ply = node.ply - base_ply
+        nodes[ply] = nodes.get(ply, 0) + 1
+        reasons.setdefault(ply, {})
+        reasons[ply][node.reason] = reasons[ply].get(node.reason, 0) + 1
+        if node.reason == "cutoff" and len(node.children) == 1:
+            first_cuts[ply] = first_cuts.get(ply, 0) + 1
+
+    print(f"{'ply':>4} {'nodes':>10} {'ebf':>7} {'1st-cut%':>9}  reasons")
+    for ply in sorted(nodes):
+        ebf = f"{nodes[ply + 1] / nodes[ply]:.2f}" if ply + 1 in nodes else "-"
+        cuts = reasons[ply].get("cutoff", 0)
+        first = f"{100.0 * first_cuts.get(ply, 0) / cuts:.1f}" if cuts else "-"
+        detail = " ".join(f"{r}={n}" for r, n in sorted(reasons[ply].items(), key=lambda kv: -kv[1]))
+        print(f"{ply:>4} {nodes[ply]:>10} {ebf:>7} {first:>9}  {detail}")
+
+
+def show(node, depth, indent=0):
+    size = sum(1 for _ in walk(node))
+    print(f"{'  ' * indent}{node.move} score {node.score} window [{node.alpha}, {node.beta}] "
+          f"{node.reason} nodes {size}")
+    if depth > 0:
+        for child in node.children:
+            show(child, depth - 1, indent + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace")
+    parser.add_argument("--thread", type=int, default=0, help="search thread id in the file")
+    parser.add_argument("--tree", type=int, default=-1, help="root iteration, default the last")
+    parser.add_argument("--path", default="", help="comma separated moves from the root")
+    parser.add_argument("--show", type=int, default=-1, help="print the subtree this many plies deep")
+    args = parser.parse_args()
+
+    streams = read_streams(args.trace)
+    if args.thread not in streams:
+        sys.exit(f"no thread {args.thread} in {args.trace}")
+
+    trees = build_trees(streams[args.thread])
+    if not trees:
+        sys.exit("no finished root iteration in the trace")
+
+    sizes = [sum(1 for _ in walk(t)) for t in trees]
+    print("iterations: " + " ".join(str(s) for s in sizes))
+    if len(sizes) > 1:
+        print("ebf between iterations: " +
+              " ".join(f"{b / a:.2f}" for a, b in zip(sizes, sizes[1:]) if a))
+
+    try:
+        node = trees[args.tree]
+    except IndexError:
+        sys.exit(f"only {len(trees)} trees in the trace")
+
+    for move in filter(None, args.path.split(",")):
+        # the last visit wins if a move was searched twice (re-search)
+        matches = [c for c in node.children if c.move == move]
+        if not matches:
+            sys.exit(f"{move} was not searched below {node.move}")
+        node = matches[-1]
+
+    print()
+    report(node, node.ply)
+    if args.show >= 0:
+        print()
+        show(node, args.show)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
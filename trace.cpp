@@ -0,0 +1,73 @@
+#include <chrono>
+
+#include "include/trace.h"
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const std::string& path) {
+    close();
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+
+    std::fwrite(kTraceMagic, 1, sizeof(kTraceMagic), file_);
+    done_ = false;
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void TraceWriter::close() {
+    if (!file_) return;
+
+    done_ = true;
+    if (thread_.joinable()) thread_.join();
+    drain();
+
+    std::fclose(file_);
+    file_ = nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    traces_.clear();
+}
+
+SearchTrace* TraceWriter::add_thread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    traces_.push_back(std::make_unique<SearchTrace>(static_cast<uint32_t>(traces_.size())));
+    return traces_.back().get();
+}
+
+void TraceWriter::run() {
+    while (!done_.load()) {
+        if (!drain()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// copies out whatever each ring holds, as one chunk per ring.
+// returns true if anything was written.
+bool TraceWriter::drain() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool wrote = false;
+
+    for (auto& trace : traces_) {
+        const uint64_t tail = trace->tail_.load(std::memory_order_relaxed);
+        const uint64_t head = trace->head_.load(std::memory_order_acquire);
+        if (head == tail) continue;
+
+        uint32_t header[2] = {trace->id_, static_cast<uint32_t>(head - tail)};
+        std::fwrite(header, sizeof(header), 1, file_);
+
+        // the live part can wrap past the end of the ring
+        const size_t start = tail & (SearchTrace::kCapacity - 1);
+        const size_t first = std::min<uint64_t>(head - tail, SearchTrace::kCapacity - start);
+        std::fwrite(&trace->ring_[start], sizeof(TraceNode), first, file_);
+        std::fwrite(&trace->ring_[0], sizeof(TraceNode), (head - tail) - first, file_);
+
+        trace->tail_.store(head, std::memory_order_release);
+        wrote = true;
+    }
+
+    if (wrote) std::fflush(file_);
+    return wrote;
+}
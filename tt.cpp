@@ -0,0 +1,204 @@
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "include/tt.h"
+
+namespace {
+
+constexpr char kHashMagic[8] = {'C', 'E', 'H', 'A', 'S', 'H', '0', '1'};
+constexpr uint32_t kHashVersion = 2;
+
+// 64 bytes so the entries after it stay aligned in the mapping
+struct HashFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t entry_count;
+    uint64_t size_mb;
+    uint64_t key_scheme;
+    uint64_t eval_scheme;
+    uint8_t pad[16];
+};
+
+static_assert(sizeof(HashFileHeader) == 64, "hash file header is 64 bytes");
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t mb) {
+    resize(mb);
+}
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+// back to an owned (empty) table, unmapping a loaded file
+void TranspositionTable::release() {
+#ifndef _WIN32
+    if (mapping_) munmap(mapping_, mapping_size_);
+#endif
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    entries_ = owned_.data();
+}
+
+void TranspositionTable::resize(size_t mb) {
+    if (mb < 1) mb = 1;
+
+    // round down to a power of two so the index is a mask
+    size_t count = 1;
+    while (count * 2 * sizeof(TTEntry) <= mb * 1024 * 1024) count *= 2;
+
+    release();
+    owned_.assign(count, TTEntry{});
+    entries_ = owned_.data();
+    mask_ = count - 1;
+    mb_ = mb;
+}
+
+void TranspositionTable::clear() {
+    if (mapping_) {
+        resize(mb_);
+        return;
+    }
+    owned_.assign(owned_.size(), TTEntry{});
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& out) const {
+    const TTEntry& e = entries_[key & mask_];
+    if (!e.used || e.key != key) return false;
+
+    out = e;
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, TTBound bound, Move best) {
+    TTEntry& e = entries_[key & mask_];
+
+    // keep deeper results for the same position
+    if (e.used && e.key == key && e.depth > depth) return;
+
+    e.key = key;
+    e.score = score;
+    e.depth = static_cast<int16_t>(depth);
+    e.bound = bound;
+    e.used = 1;
+    e.from = static_cast<int8_t>(best.from);
+    e.to = static_cast<int8_t>(best.to);
+}
+
+bool TranspositionTable::save(const std::string& path, uint64_t key_scheme, uint64_t eval_scheme,
+                              std::string& error) const {
+    HashFileHeader header{};
+    std::memcpy(header.magic, kHashMagic, sizeof(kHashMagic));
+    header.version = kHashVersion;
+    header.entry_size = sizeof(TTEntry);
+    header.entry_count = mask_ + 1;
+    header.size_mb = mb_;
+    header.key_scheme = key_scheme;
+    header.eval_scheme = eval_scheme;
+
+    // written beside the target and renamed over it, because the table may
+    // be a mapping of that very file
+    const std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        error = "cannot write " + path;
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+              std::fwrite(entries_, sizeof(TTEntry), mask_ + 1, f) == mask_ + 1;
+    ok = (std::fclose(f) == 0) && ok;
+
+    if (ok) {
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) {
+        std::remove(tmp.c_str());
+        error = "cannot write " + path;
+    }
+    return ok;
+}
+
+bool TranspositionTable::load(const std::string& path, uint64_t key_scheme, uint64_t eval_scheme, std::string& error) {
+    HashFileHeader header{};
+
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        error = "cannot read " + path;
+        return false;
+    }
+    const bool got_header = std::fread(&header, sizeof(header), 1, f) == 1;
+    std::fseek(f, 0, SEEK_END);
+    const long file_size = std::ftell(f);
+
+    const uint64_t count = header.entry_count;
+    if (!got_header || std::memcmp(header.magic, kHashMagic, sizeof(kHashMagic)) != 0) {
+        error = "not a hash file";
+    } else if (header.version != kHashVersion || header.entry_size != sizeof(TTEntry)) {
+        error = "hash file version " + std::to_string(header.version) + " is not supported";
+    } else if (header.key_scheme != key_scheme) {
+        error = "hash file was written with different position keys";
+    } else if (header.eval_scheme != eval_scheme) {
+        error = "hash file was written with different evaluation parameters";
+    } else if (count == 0 || (count & (count - 1)) != 0 ||
+               static_cast<uint64_t>(file_size) != sizeof(header) + count * sizeof(TTEntry)) {
+        error = "hash file size doesn't match its header";
+    }
+    if (!error.empty()) {
+        std::fclose(f);
+        return false;
+    }
+
+#ifndef _WIN32
+    std::fclose(f);
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot read " + path;
+        return false;
+    }
+    // private and writable: stores land in our copy of the page, never the file
+    void* p = mmap(nullptr, static_cast<size_t>(file_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+
+    release();
+    owned_.clear();
+    owned_.shrink_to_fit();
+    mapping_ = p;
+    mapping_size_ = static_cast<size_t>(file_size);
+    entries_ = reinterpret_cast<TTEntry*>(static_cast<char*>(p) + sizeof(header));
+#else
+    std::vector<TTEntry> entries(count);
+    std::fseek(f, sizeof(header), SEEK_SET);
+    const bool ok = std::fread(entries.data(), sizeof(TTEntry), count, f) == count;
+    std::fclose(f);
+    if (!ok) {
+        error = "cannot read " + path;
+        return false;
+    }
+
+    release();
+    owned_ = std::move(entries);
+    entries_ = owned_.data();
+#endif
+
+    mask_ = count - 1;
+    mb_ = header.size_mb;
+    return true;
+}
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "include/mapped_file.h"
+#include "include/pst_tables.h"
+#include "include/tune.h"
+
+TuneParams current_params() {
+    TuneParams params{};
+    for (int p = W_PAWN; p < W_KING; p++) params[kTuneMaterial + p] = get_piece_value(static_cast<Piece>(p));
+    for (int sq = 0; sq < 64; sq++) {
+        params[kTunePawnTable + sq] = pawn_table[sq];
+        params[kTuneKnightTable + sq] = knight_table[sq];
+    }
+    return params;
+}
+
+void add_position(TuneSet& set, const Board& b, float result) {
+    int8_t counts[kTuneParams] = {};
+
+    for (int sq = 0; sq < 64; sq++) {
+        const Piece p = b.board[sq];
+        if (p == EMPTY || p == W_KING || p == B_KING) continue;
+
+        const bool white = p <= W_KING;
+        const int kind = white ? p : p - B_PAWN;
+        const int sign = white ? 1 : -1;
+        const int table_sq = white ? sq : 63 - sq;
+
+        counts[kTuneMaterial + kind] += sign;
+        if (kind == W_PAWN) counts[kTunePawnTable + table_sq] += sign;
+        else if (kind == W_KNIGHT) counts[kTuneKnightTable + table_sq] += sign;
+    }
+
+    for (int i = 0; i < kTuneParams; i++) {
+        if (counts[i] == 0) continue;
+        set.feature.push_back(static_cast<uint8_t>(i));
+        set.count.push_back(counts[i]);
+    }
+    set.begin.push_back(static_cast<uint32_t>(set.feature.size()));
+    set.result.push_back(result);
+}
+
+static bool parse_result(std::string_view token, float& result) {
+    if (token == "1-0") result = 1.0f;
+    else if (token == "0-1") result = 0.0f;
+    else if (token == "1/2-1/2") result = 0.5f;
+    else return false;
+    return true;
+}
+
+// true if the static eval is taken in the middle of something: the side to
+// move is in check or can win material with a capture
+static bool is_noisy(const Board& b) {
+    const Color them = (b.side_to_move == WHITE) ? BLACK : WHITE;
+    if (is_square_attacked(b, find_king(b, b.side_to_move), them)) return true;
+
+    std::vector<Move> captures;
+    generate_captures(b, captures);
+    for (Move move : captures) {
+        if (see(b, move) > 0) return true;
+    }
+    return false;
+}
+
+// parses the lines of one shard of the file into its own set
+static void load_shard(std::string_view text, TuneSet& set, uint64_t& skipped) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        const size_t first_tab = line.find('\t');
+        const size_t last_tab = line.rfind('\t');
+        float result;
+        if (first_tab == std::string_view::npos || !parse_result(line.substr(last_tab + 1), result)) {
+            skipped++;
+            continue;
+        }
+
+        const std::string_view fen = line.substr(0, first_tab);
+        if (!is_valid_fen(fen)) {
+            skipped++;
+            continue;
+        }
+
+        Board b;
+        load_fen(b, std::string(fen));
+        if (is_noisy(b)) {
+            skipped++;
+            continue;
+        }
+
+        add_position(set, b, result);
+    }
+}
+
+bool load_tune_set(const std::string& path, int threads, TuneSet& set, uint64_t& skipped, std::string& error) {
+    MappedFile file;
+    if (!file.open(path)) {
+        error = "cannot read " + path;
+        return false;
+    }
+
+    std::string_view text = file.data();
+    if (threads < 1) threads = 1;
+
+    // cut into roughly equal shards, moving each cut forward to a line start
+    std::vector<size_t> cuts = {0};
+    for (int i = 1; i < threads; i++) {
+        size_t nominal = std::max(cuts.back(), text.size() * i / threads);
+        size_t next = text.find('\n', nominal);
+        if (next == std::string_view::npos) break;
+        if (next + 1 > cuts.back()) cuts.push_back(next + 1);
+    }
+    cuts.push_back(text.size());
+
+    const size_t shards = cuts.size() - 1;
+    std::vector<TuneSet> parts(shards);
+    std::vector<uint64_t> part_skipped(shards, 0);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < shards; i++) {
+        workers.emplace_back([&, i] { load_shard(text.substr(cuts[i], cuts[i + 1] - cuts[i]), parts[i], part_skipped[i]); });
+    }
+    for (auto& t : workers) t.join();
+
+    size_t positions = set.size();
+    size_t entries = set.feature.size();
+    for (const auto& part : parts) {
+        positions += part.size();
+        entries += part.feature.size();
+    }
+    set.result.reserve(positions);
+    set.begin.reserve(positions + 1);
+    set.feature.reserve(entries);
+    set.count.reserve(entries);
+
+    for (size_t i = 0; i < shards; i++) {
+        const TuneSet& part = parts[i];
+        const uint32_t base = static_cast<uint32_t>(set.feature.size());
+
+        set.result.insert(set.result.end(), part.result.begin(), part.result.end());
+        for (size_t j = 1; j < part.begin.size(); j++) set.begin.push_back(base + part.begin[j]);
+        set.feature.insert(set.feature.end(), part.feature.begin(), part.feature.end());
+        set.count.insert(set.count.end(), part.count.begin(), part.count.end());
+        skipped += part_skipped[i];
+    }
+
+    return true;
+}
+
+// mean squared error between the results and the win probability the
+// evaluation implies, 1 / (1 + 10^(-k * eval / 400)). with grad set it also
+// gets the gradient by every parameter. positions are split over threads,
+// each summing into its own gradient.
+static double tune_error(const TuneSet& set, const TuneParams& params, double k, int threads, TuneParams* grad) {
+    const size_t n = set.size();
+    if (n == 0) return 0.0;
+
+    const double scale = k * std::log(10.0) / 400.0;
+    threads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(threads, n)));
+
+    std::vector<double> errors(threads, 0.0);
+    std::vector<TuneParams> grads(grad ? threads : 0, TuneParams{});
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            const size_t first = n * t / threads;
+            const size_t last = n * (t + 1) / threads;
+            double error = 0.0;
+            TuneParams* g = grad ? &grads[t] : nullptr;
+
+            for (size_t i = first; i < last; i++) {
+                const uint32_t lo = set.begin[i];
+                const uint32_t hi = set.begin[i + 1];
+
+                double eval = 0.0;
+                for (uint32_t j = lo; j < hi; j++) eval += params[set.feature[j]] * set.count[j];
+
+                const double s = 1.0 / (1.0 + std::exp(-scale * eval));
+                const double diff = set.result[i] - s;
+                error += diff * diff;
+
+                if (g) {
+                    const double d = -2.0 * diff * s * (1.0 - s) * scale;
+                    for (uint32_t j = lo; j < hi; j++) (*g)[set.feature[j]] += d * set.count[j];
+                }
+            }
+            errors[t] = error;
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    double error = 0.0;
+    for (double e : errors) error += e;
+
+    if (grad) {
+        grad->fill(0.0);
+        for (const auto& g : grads) {
+            for (int p = 0; p < kTuneParams; p++) (*grad)[p] += g[p] / n;
+        }
+    }
+    return error / n;
+}
+
+// the sigmoid scale that fits the results best with these parameters
+static double fit_scale(const TuneSet& set, const TuneParams& params, int threads) {
+    double lo = 0.05;
+    double hi = 5.0;
+
+    // the error is unimodal in k, so ternary search
+    for (int i = 0; i < 40; i++) {
+        double m1 = lo + (hi - lo) / 3;
+        double m2 = hi - (hi - lo) / 3;
+        if (tune_error(set, params, m1, threads, nullptr) < tune_error(set, params, m2, threads, nullptr)) hi = m2;
+        else lo = m1;
+    }
+    return (lo + hi) / 2;
+}
+
+static void write_table(std::ostream& out, const char* name, const TuneParams& params, int first) {
+    out << "const int " << name << "[64] = {\n";
+    for (int rank = 0; rank < 8; rank++) {
+        out << "    ";
+        for (int file = 0; file < 8; file++) {
+            char cell[16];
+            std::snprintf(cell, sizeof(cell), "%3ld", std::lround(params[first + rank * 8 + file]));
+            out << cell << (rank * 8 + file < 63 ? "," : "");
+        }
+        out << "\n";
+    }
+    out << "};\n";
+}
+
+static bool write_params(const std::string& path, const TuneParams& params, size_t positions, double error) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    std::ostringstream values;
+    for (int p = W_PAWN; p < W_KING; p++) values << std::lround(params[kTuneMaterial + p]) << ", ";
+    values << get_piece_value(W_KING);
+
+    out << "#ifndef PST_TABLES_H\n"
+           "#define PST_TABLES_H\n"
+           "\n"
+           "// evaluation parameters. `chess_engine tune` writes a regenerated copy of\n"
+           "// this file with tuned values.\n"
+           "// tuned on " << positions << " positions, mean squared error " << error << ".\n"
+           "\n"
+           "// centipawns by Piece. the king's value cancels out of evaluate and only\n"
+           "// matters to SEE.\n"
+           "const int piece_values[13] = {\n"
+           "    " << values.str() << ",\n"
+           "    " << values.str() << ",\n"
+           "    0\n"
+           "};\n"
+           "\n";
+    write_table(out, "pawn_table", params, kTunePawnTable);
+    out << "\n";
+    write_table(out, "knight_table", params, kTuneKnightTable);
+    out << "\n#endif\n";
+
+    return static_cast<bool>(out);
+}
+
+int run_tune(const TuneOptions& options, std::ostream& log) {
+    const int threads = std::max(1, options.threads > 0 ? options.threads
+                                                        : static_cast<int>(std::thread::hardware_concurrency()));
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    TuneSet set;
+    uint64_t skipped = 0;
+    std::string error;
+    if (!load_tune_set(options.path, threads, set, skipped, error)) {
+        log << error << std::endl;
+        return 1;
+    }
+    if (set.size() == 0) {
+        log << "no usable positions in " << options.path << std::endl;
+        return 1;
+    }
+    log << "positions " << set.size() << " skipped " << skipped << " features " << set.feature.size()
+        << " seconds " << elapsed() << std::endl;
+
+    TuneParams params = current_params();
+    const double k = fit_scale(set, params, threads);
+    const double initial = tune_error(set, params, k, threads, nullptr);
+    log << "k " << k << " error " << initial << std::endl;
+
+    // Adam, so parameters that few positions touch (pawns on the 7th,
+    // knights in the corners) still move at the same pace as material
+    constexpr double kBeta1 = 0.9;
+    constexpr double kBeta2 = 0.999;
+    constexpr double kEpsilon = 1e-8;
+    TuneParams m{};
+    TuneParams v{};
+    TuneParams grad{};
+    double current = initial;
+    const int report_every = std::max(1, options.iterations / 20);
+
+    for (int it = 1; it <= options.iterations; it++) {
+        current = tune_error(set, params, k, threads, &grad);
+
+        const double bias1 = 1.0 - std::pow(kBeta1, it);
+        const double bias2 = 1.0 - std::pow(kBeta2, it);
+        for (int p = 0; p < kTuneParams; p++) {
+            m[p] = kBeta1 * m[p] + (1 - kBeta1) * grad[p];
+            v[p] = kBeta2 * v[p] + (1 - kBeta2) * grad[p] * grad[p];
+            params[p] -= options.rate * (m[p] / bias1) / (std::sqrt(v[p] / bias2) + kEpsilon);
+        }
+
+        if (it % report_every == 0) log << "iteration " << it << " error " << current << std::endl;
+    }
+
+    const double final_error = tune_error(set, params, k, threads, nullptr);
+    log << "error " << initial << " -> " << final_error << " seconds " << elapsed() << std::endl;
+
+    if (!write_params(options.out_path, params, set.size(), final_error)) {
+        log << "cannot write " << options.out_path << std::endl;
+        return 1;
+    }
+    log << "wrote " << options.out_path << std::endl;
+    return 0;
+}
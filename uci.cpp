@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <sstream>
+
+#include "include/profile.h"
+#include "include/uci.h"
+
+std::vector<std::string> split_tokens(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::istringstream iss(line);
+    std::string tok;
+    while (iss >> tok) tokens.push_back(tok);
+    return tokens;
+}
+
+// collects `[moves ...]` after index start of a position command
+static std::vector<std::string> collect_moves(const std::vector<std::string>& tokens, size_t start) {
+    std::vector<std::string> moves;
+    if (start < tokens.size() && tokens[start] == "moves") {
+        moves.assign(tokens.begin() + start + 1, tokens.end());
+    }
+    return moves;
+}
+
+bool handle_uci_command(Engine& engine, const std::vector<std::string>& tokens, std::ostream& out) {
+    constexpr int kDefaultDepth = 3;
+    constexpr int kMaxMateMoves = 16;
+
+    if (tokens.empty()) return true;
+
+    const std::string& cmd = tokens[0];
+
+    if (cmd == "uci") {
+
+        out << "id name simple_engine" << std::endl;
+        out << "id author el-tahir" << std::endl;
+        out << "option name Hash type spin default 16 min 1 max 1024" << std::endl;
+        out << "option name MultiPV type spin default 1 min 1 max 256" << std::endl;
+        out << "uciok" << std::endl;
+
+    } else if (cmd == "isready") {
+
+        out << "readyok" << std::endl;
+    } else if (cmd == "ucinewgame") {
+        engine.new_game();
+
+
+    } else if (cmd == "position") {
+
+        bool ok = false;
+        if (tokens.size() >= 2 && tokens[1] == "startpos") {
+            ok = engine.set_position("startpos", collect_moves(tokens, 2));
+        } else if (tokens.size() >= 8 && tokens[1] == "fen") {
+            std::string fen;
+            for (size_t i = 2; i < 8; i++) {
+                if (i > 2) fen += " ";
+                fen += tokens[i];
+            }
+            ok = engine.set_position(fen, collect_moves(tokens, 8));
+        }
+        // the previous position stays, so a later go still has something to search
+        if (!ok) out << "info string invalid position or move, position unchanged" << std::endl;
+    } else if (cmd == "setoption") {
+        // unknown options are ignored, but command support keeps UCI clients happy.
+        if (tokens.size() >= 5 && tokens[1] == "name" && tokens[3] == "value") {
+            engine.set_option(tokens[2], tokens[4]);
+        }
+    } else if (cmd == "go" && tokens.size() >= 3 && tokens[1] == "mate") {
+        int moves = 0;
+        try {
+            moves = std::clamp(std::stoi(tokens[2]), 1, kMaxMateMoves);
+        } catch (...) {
+            moves = 1;
+        }
+
+        MateResult mate = engine.find_mate(moves);
+        if (mate.mate_in > 0) {
+            out << "info depth " << (2 * mate.mate_in - 1) << " score mate " << mate.mate_in
+                << " nodes " << mate.nodes << " pv "
+                << index_to_square(mate.move.from) << index_to_square(mate.move.to) << std::endl;
+            out << "bestmove " << index_to_square(mate.move.from)
+                << index_to_square(mate.move.to) << std::endl;
+            return true;
+        }
+
+        // no mate, answer with a normal search so the gui still gets a move
+        out << "info string no mate in " << moves << " found, nodes " << mate.nodes << std::endl;
+        return handle_uci_command(engine, {"go", "depth", std::to_string(kDefaultDepth)}, out);
+    } else if (cmd == "go") {
+        int depth = kDefaultDepth;
+        for (size_t i = 1; i + 1 < tokens.size(); i++) {
+            if (tokens[i] == "depth") {
+                try {
+                    depth = std::stoi(tokens[i + 1]);
+                } catch (...) {
+                    depth = kDefaultDepth;
+                }
+                break;
+            }
+        }
+        depth = std::clamp(depth, 1, kMaxSearchDepth);
+
+        SearchResult result = engine.search(depth);
+        if (result.lines.empty()) {
+            out << "bestmove 0000" << std::endl;
+        } else {
+            for (size_t k = 0; k < result.lines.size(); k++) {
+                const RootLine& root = result.lines[k];
+                // search scores are white-relative, UCI wants side to move
+                int cp = is_white_turn(engine.board()) ? root.score : -root.score;
+                out << "info depth " << result.depth << " multipv " << (k + 1)
+                    << " score cp " << cp << " nodes " << result.nodes << " pv "
+                    << index_to_square(root.move.from)
+                    << index_to_square(root.move.to) << std::endl;
+            }
+            Move best = result.lines[0].move;
+            out << "bestmove " << index_to_square(best.from)
+                << index_to_square(best.to) << std::endl;
+        }
+    } else if (cmd == "trace" && tokens.size() >= 2) {
+        const std::string path = (tokens[1] == "off") ? "" : tokens[1];
+        if (!engine.set_trace(path)) out << "info string cannot write " << path << std::endl;
+    } else if ((cmd == "save_hash" || cmd == "load_hash") && tokens.size() >= 2) {
+        std::string error;
+        bool ok = (cmd == "save_hash") ? engine.save_hash(tokens[1], error) : engine.load_hash(tokens[1], error);
+        if (!ok) out << "info string " << error << std::endl;
+    } else if (cmd == "profile") {
+        if (tokens.size() >= 2 && tokens[1] == "reset") profile_reset();
+        else profile_report(out);
+    } else if (cmd == "quit") {
+#ifdef CHESS_PROFILE
+        profile_report(out);
+#endif
+        return false;
+    }
+
+    return true;
+}